@@ -170,7 +170,8 @@ Core::hookPeriodicInsCheck()
       m_instructions_hpi_last = m_instructions;
 
       // Quick, unlocked check if we should do the HOOK_PERIODIC_INS callback
-      if (g_instructions_hpi_global > g_instructions_hpi_global_callback)
+      if (g_instructions_hpi_global > g_instructions_hpi_global_callback
+          && Sim()->getHooksManager()->hasHooks(HookType::HOOK_PERIODIC_INS))
          hookPeriodicInsCall();
    }
 }
@@ -123,33 +123,25 @@ void
 Cache::insertSingleLine(IntPtr addr, Byte* fill_buff,
       bool* eviction, IntPtr* evict_addr,
       CacheBlockInfo* evict_block_info, Byte* evict_buff,
-      SubsecondTime now, CacheCntlr *cntlr)
+      SubsecondTime now, CacheCntlr *cntlr, UInt64 way_mask)
 {
    IntPtr tag;
    UInt32 set_index;
    splitAddress(addr, tag, set_index);
 
-   CacheBlockInfo* cache_block_info = CacheBlockInfo::create(m_cache_type);
-   cache_block_info->setTag(tag);
-
-   m_sets[set_index]->insert(cache_block_info, fill_buff,
-         eviction, evict_block_info, evict_buff, cntlr);
+   // The victim way is overwritten in place, no block info is allocated on the fill path
+   UInt32 line_index = m_sets[set_index]->insert(tag, CacheState::INVALID, fill_buff,
+         eviction, evict_block_info, evict_buff, cntlr, way_mask);
    *evict_addr = tagToAddress(evict_block_info->getTag());
 
    if (m_fault_injector) {
       // NOTE: no callback is generated for read of evicted data
-      UInt32 line_index = -1;
-      __attribute__((unused)) CacheBlockInfo* res = m_sets[set_index]->find(tag, &line_index);
-      LOG_ASSERT_ERROR(res != NULL, "Inserted line no longer there?");
-
       m_fault_injector->postWrite(addr, set_index * m_associativity + line_index, m_sets[set_index]->getBlockSize(), (Byte*)m_sets[set_index]->getDataPtr(line_index, 0), now);
    }
 
    #ifdef ENABLE_SET_USAGE_HIST
    ++m_set_usage_hist[set_index];
    #endif
-
-   delete cache_block_info;
 }
 
 
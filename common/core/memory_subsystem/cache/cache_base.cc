@@ -3,6 +3,8 @@
 #include "log.h"
 #include "rng.h"
 #include "address_home_lookup.h"
+#include "simulator.h"
+#include "config.hpp"
 
 CacheBase::CacheBase(
    String name, UInt32 num_sets, UInt32 associativity, UInt32 cache_block_size,
@@ -26,6 +28,14 @@ CacheBase::~CacheBase()
 {}
 
 // utilities
+bool
+CacheBase::isTagOnly()
+{
+   // Data contents are never consumed by the timing model, only fault injection needs them
+   static bool tag_only = Sim()->getCfg()->getBool("perf_model/cache/tag_only") && !Sim()->getFaultinjectionManager();
+   return tag_only;
+}
+
 CacheBase::hash_t
 CacheBase::parseAddressHash(String hash_name)
 {
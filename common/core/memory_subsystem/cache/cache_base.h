@@ -57,6 +57,8 @@ class CacheBase
          SRRIP,
          SRRIP_QBS,
          RANDOM,
+         DRRIP,
+         SHIP,
          NUM_REPLACEMENT_POLICIES
       };
 
@@ -88,6 +90,9 @@ class CacheBase
       UInt32 getAssociativity() const { return m_associativity; }
 
       static hash_t parseAddressHash(String hash_name);
+
+      // True when caches only track tags and states, and no cache line contents are stored or copied
+      static bool isTagOnly();
 };
 
 #endif /* __CACHE_BASE_H__ */
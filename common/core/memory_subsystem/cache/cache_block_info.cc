@@ -22,13 +22,35 @@ const char* CacheBlockInfo::getOptionName(option_t option)
 
 
 CacheBlockInfo::CacheBlockInfo(IntPtr tag, CacheState::cstate_t cstate, UInt64 options):
-   m_tag(tag),
+   m_tag(&m_tag_storage),
+   m_tag_storage(tag),
    m_cstate(cstate),
    m_owner(0),
    m_used(0),
    m_options(options)
 {}
 
+CacheBlockInfo::CacheBlockInfo(const CacheBlockInfo &other):
+   m_tag(&m_tag_storage),
+   m_tag_storage(other.getTag()),
+   m_cstate(other.m_cstate),
+   m_owner(other.m_owner),
+   m_used(other.m_used),
+   m_options(other.m_options)
+{}
+
+CacheBlockInfo&
+CacheBlockInfo::operator=(const CacheBlockInfo &other)
+{
+   // Copy the contents, but keep using our own tag storage
+   *m_tag = other.getTag();
+   m_cstate = other.m_cstate;
+   m_owner = other.m_owner;
+   m_used = other.m_used;
+   m_options = other.m_options;
+   return *this;
+}
+
 CacheBlockInfo::~CacheBlockInfo()
 {}
 
@@ -52,23 +74,87 @@ CacheBlockInfo::create(CacheBase::cache_t cache_type)
    }
 }
 
+template <typename T>
+static void createBlockArray(UInt32 count, CacheBlockInfo **blocks)
+{
+   T *array = new T[count];
+   for (UInt32 i = 0; i < count; i++)
+      blocks[i] = &array[i];
+}
+
+void
+CacheBlockInfo::createArray(CacheBase::cache_t cache_type, UInt32 count, CacheBlockInfo **blocks)
+{
+   switch (cache_type)
+   {
+      case CacheBase::PR_L1_CACHE:
+         createBlockArray<PrL1CacheBlockInfo>(count, blocks);
+         break;
+
+      case CacheBase::PR_L2_CACHE:
+         createBlockArray<PrL2CacheBlockInfo>(count, blocks);
+         break;
+
+      case CacheBase::SHARED_CACHE:
+         createBlockArray<SharedCacheBlockInfo>(count, blocks);
+         break;
+
+      default:
+         LOG_PRINT_ERROR("Unrecognized cache type (%u)", cache_type);
+   }
+}
+
+void
+CacheBlockInfo::destroyArray(CacheBase::cache_t cache_type, CacheBlockInfo **blocks)
+{
+   switch (cache_type)
+   {
+      case CacheBase::PR_L1_CACHE:
+         delete [] static_cast<PrL1CacheBlockInfo*>(blocks[0]);
+         break;
+
+      case CacheBase::PR_L2_CACHE:
+         delete [] static_cast<PrL2CacheBlockInfo*>(blocks[0]);
+         break;
+
+      case CacheBase::SHARED_CACHE:
+         delete [] static_cast<SharedCacheBlockInfo*>(blocks[0]);
+         break;
+
+      default:
+         LOG_PRINT_ERROR("Unrecognized cache type (%u)", cache_type);
+   }
+}
+
 void
 CacheBlockInfo::invalidate()
 {
-   m_tag = ~0;
+   *m_tag = ~0;
    m_cstate = CacheState::INVALID;
 }
 
 void
 CacheBlockInfo::clone(CacheBlockInfo* cache_block_info)
 {
-   m_tag = cache_block_info->getTag();
+   *m_tag = cache_block_info->getTag();
    m_cstate = cache_block_info->getCState();
    m_owner = cache_block_info->m_owner;
    m_used = cache_block_info->m_used;
    m_options = cache_block_info->m_options;
 }
 
+void
+CacheBlockInfo::reset(IntPtr tag, CacheState::cstate_t cstate)
+{
+   // invalidate() also clears the fields of derived classes
+   invalidate();
+   *m_tag = tag;
+   m_cstate = cstate;
+   m_owner = 0;
+   m_used = 0;
+   m_options = 0;
+}
+
 bool
 CacheBlockInfo::updateUsage(UInt32 offset, UInt32 size)
 {
@@ -21,7 +21,10 @@ class CacheBlockInfo
    // This can be extended later to include other information
    // for different cache coherence protocols
    private:
-      IntPtr m_tag;
+      // Blocks that live in a CacheSet keep their tag in the set's contiguous tag array (see bindTag),
+      // so lookups can compare all ways at once. Stand-alone blocks use m_tag_storage.
+      IntPtr *m_tag;
+      IntPtr m_tag_storage;
       CacheState::cstate_t m_cstate;
       UInt64 m_owner;
       BitsUsedType m_used;
@@ -33,19 +36,29 @@ class CacheBlockInfo
       CacheBlockInfo(IntPtr tag = ~0,
             CacheState::cstate_t cstate = CacheState::INVALID,
             UInt64 options = 0);
+      CacheBlockInfo(const CacheBlockInfo &other);
+      CacheBlockInfo& operator=(const CacheBlockInfo &other);
       virtual ~CacheBlockInfo();
 
       static CacheBlockInfo* create(CacheBase::cache_t cache_type);
+      // Allocate count blocks in one contiguous array, and fill in a pointer to each of them in blocks[]
+      static void createArray(CacheBase::cache_t cache_type, UInt32 count, CacheBlockInfo **blocks);
+      static void destroyArray(CacheBase::cache_t cache_type, CacheBlockInfo **blocks);
+
+      // Move this block's tag into external storage (e.g. a CacheSet's tag array)
+      void bindTag(IntPtr *storage) { *storage = *m_tag; m_tag = storage; }
 
       virtual void invalidate(void);
       virtual void clone(CacheBlockInfo* cache_block_info);
+      // Make this block look like a newly created one holding tag, without allocating a new block
+      void reset(IntPtr tag, CacheState::cstate_t cstate = CacheState::INVALID);
 
-      bool isValid() const { return (m_tag != ((IntPtr) ~0)); }
+      bool isValid() const { return (*m_tag != ((IntPtr) ~0)); }
 
-      IntPtr getTag() const { return m_tag; }
+      IntPtr getTag() const { return *m_tag; }
       CacheState::cstate_t getCState() const { return m_cstate; }
 
-      void setTag(IntPtr tag) { m_tag = tag; }
+      void setTag(IntPtr tag) { *m_tag = tag; }
       void setCState(CacheState::cstate_t cstate) { m_cstate = cstate; }
 
       UInt64 getOwner() const { return m_owner; }
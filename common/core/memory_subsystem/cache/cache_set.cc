@@ -7,23 +7,42 @@
 #include "cache_set_random.h"
 #include "cache_set_round_robin.h"
 #include "cache_set_srrip.h"
+#include "cache_set_drrip.h"
+#include "cache_set_ship.h"
 #include "cache_base.h"
 #include "log.h"
 #include "simulator.h"
 #include "config.h"
 #include "config.hpp"
 
+#if defined(__x86_64__) && (defined(__AVX2__) || defined(__SSE2__))
+#include <immintrin.h>
+#endif
+
+// Number of tags compared at once, the tag array is padded to a multiple of this
+#if defined(__x86_64__) && defined(__AVX2__)
+static const UInt32 TAG_LANES = 4;
+#else
+static const UInt32 TAG_LANES = 2;
+#endif
+
 CacheSet::CacheSet(CacheBase::cache_t cache_type,
       UInt32 associativity, UInt32 blocksize):
-      m_associativity(associativity), m_blocksize(blocksize)
+      m_cache_type(cache_type), m_associativity(associativity), m_blocksize(blocksize),
+      m_allowed_ways(ALL_WAYS)
 {
    m_cache_block_info_array = new CacheBlockInfo*[m_associativity];
+   CacheBlockInfo::createArray(cache_type, m_associativity, m_cache_block_info_array);
+
+   UInt32 num_tags = (m_associativity + TAG_LANES - 1) / TAG_LANES * TAG_LANES;
+   int res = posix_memalign((void**)&m_tags, 32, num_tags * sizeof(IntPtr));
+   LOG_ASSERT_ERROR(res == 0, "Could not allocate tag array");
+   for (UInt32 i = 0; i < num_tags; i++)
+      m_tags[i] = ~0;
    for (UInt32 i = 0; i < m_associativity; i++)
-   {
-      m_cache_block_info_array[i] = CacheBlockInfo::create(cache_type);
-   }
+      m_cache_block_info_array[i]->bindTag(&m_tags[i]);
 
-   if (Sim()->getFaultinjectionManager())
+   if (!CacheBase::isTagOnly())
    {
       m_blocks = new char[m_associativity * m_blocksize];
       memset(m_blocks, 0x00, m_associativity * m_blocksize);
@@ -34,9 +53,9 @@ CacheSet::CacheSet(CacheBase::cache_t cache_type,
 
 CacheSet::~CacheSet()
 {
-   for (UInt32 i = 0; i < m_associativity; i++)
-      delete m_cache_block_info_array[i];
+   CacheBlockInfo::destroyArray(m_cache_type, m_cache_block_info_array);
    delete [] m_cache_block_info_array;
+   free(m_tags);
    delete [] m_blocks;
 }
 
@@ -66,41 +85,66 @@ CacheSet::write_line(UInt32 line_index, UInt32 offset, Byte *in_buff, UInt32 byt
       updateReplacementIndex(line_index);
 }
 
-CacheBlockInfo*
-CacheSet::find(IntPtr tag, UInt32* line_index)
+// Returns the highest way holding tag, or -1
+SInt32
+CacheSet::findIndex(IntPtr tag) const
 {
-   for (SInt32 index = m_associativity-1; index >= 0; index--)
+   for (SInt32 base = (m_associativity - 1) / TAG_LANES * TAG_LANES; base >= 0; base -= TAG_LANES)
    {
-      if (m_cache_block_info_array[index]->getTag() == tag)
-      {
-         if (line_index != NULL)
-            *line_index = index;
-         return (m_cache_block_info_array[index]);
-      }
+#if defined(__x86_64__) && defined(__AVX2__)
+      __m256i cmp = _mm256_cmpeq_epi64(_mm256_load_si256((const __m256i*)&m_tags[base]), _mm256_set1_epi64x(tag));
+      UInt32 mask = _mm256_movemask_pd(_mm256_castsi256_pd(cmp));
+#elif defined(__x86_64__) && defined(__SSE2__)
+      // No 64-bit compare in SSE2: both 32-bit halves need to match
+      __m128i cmp = _mm_cmpeq_epi32(_mm_load_si128((const __m128i*)&m_tags[base]), _mm_set1_epi64x(tag));
+      cmp = _mm_and_si128(cmp, _mm_shuffle_epi32(cmp, _MM_SHUFFLE(2, 3, 0, 1)));
+      UInt32 mask = _mm_movemask_pd(_mm_castsi128_pd(cmp));
+#else
+      UInt32 mask = 0;
+      for (UInt32 lane = 0; lane < TAG_LANES; lane++)
+         if (m_tags[base + lane] == tag)
+            mask |= 1 << lane;
+#endif
+      // Ignore padding beyond the last way
+      if (m_associativity - base < TAG_LANES)
+         mask &= (1 << (m_associativity - base)) - 1;
+      if (mask)
+         return base + 31 - __builtin_clz(mask);
    }
-   return NULL;
+   return -1;
+}
+
+CacheBlockInfo*
+CacheSet::find(IntPtr tag, UInt32* line_index)
+{
+   SInt32 index = findIndex(tag);
+   if (index < 0)
+      return NULL;
+
+   if (line_index != NULL)
+      *line_index = index;
+   return (m_cache_block_info_array[index]);
 }
 
 bool
 CacheSet::invalidate(IntPtr& tag)
 {
-   for (SInt32 index = m_associativity-1; index >= 0; index--)
-   {
-      if (m_cache_block_info_array[index]->getTag() == tag)
-      {
-         m_cache_block_info_array[index]->invalidate();
-         return true;
-      }
-   }
-   return false;
+   SInt32 index = findIndex(tag);
+   if (index < 0)
+      return false;
+
+   m_cache_block_info_array[index]->invalidate();
+   return true;
 }
 
-void
-CacheSet::insert(CacheBlockInfo* cache_block_info, Byte* fill_buff, bool* eviction, CacheBlockInfo* evict_block_info, Byte* evict_buff, CacheCntlr *cntlr)
+UInt32
+CacheSet::evictLine(bool* eviction, CacheBlockInfo* evict_block_info, Byte* evict_buff, CacheCntlr *cntlr, UInt64 way_mask)
 {
    // This replacement strategy does not take into account the fact that
    // cache blocks can be voluntarily flushed or invalidated due to another write request
+   m_allowed_ways = way_mask;
    const UInt32 index = getReplacementIndex(cntlr);
+   m_allowed_ways = ALL_WAYS;
    assert(index < m_associativity);
 
    assert(eviction != NULL);
@@ -118,13 +162,36 @@ CacheSet::insert(CacheBlockInfo* cache_block_info, Byte* fill_buff, bool* evicti
       *eviction = false;
    }
 
+   return index;
+}
+
+void
+CacheSet::insert(CacheBlockInfo* cache_block_info, Byte* fill_buff, bool* eviction, CacheBlockInfo* evict_block_info, Byte* evict_buff, CacheCntlr *cntlr)
+{
+   const UInt32 index = evictLine(eviction, evict_block_info, evict_buff, cntlr);
+
    // FIXME: This is a hack. I dont know if this is the best way to do
    m_cache_block_info_array[index]->clone(cache_block_info);
+   notifyInsert(index, cache_block_info->getTag());
 
    if (fill_buff != NULL && m_blocks != NULL)
       memcpy(&m_blocks[index * m_blocksize], (void*) fill_buff, m_blocksize);
 }
 
+UInt32
+CacheSet::insert(IntPtr tag, CacheState::cstate_t cstate, Byte* fill_buff, bool* eviction, CacheBlockInfo* evict_block_info, Byte* evict_buff, CacheCntlr *cntlr, UInt64 way_mask)
+{
+   const UInt32 index = evictLine(eviction, evict_block_info, evict_buff, cntlr, way_mask);
+
+   m_cache_block_info_array[index]->reset(tag, cstate);
+   notifyInsert(index, tag);
+
+   if (fill_buff != NULL && m_blocks != NULL)
+      memcpy(&m_blocks[index * m_blocksize], (void*) fill_buff, m_blocksize);
+
+   return index;
+}
+
 char*
 CacheSet::getDataPtr(UInt32 line_index, UInt32 offset)
 {
@@ -166,6 +233,12 @@ CacheSet::createCacheSet(String cfgname, core_id_t core_id,
       case CacheBase::RANDOM:
          return new CacheSetRandom(cache_type, associativity, blocksize);
 
+      case CacheBase::DRRIP:
+         return new CacheSetDRRIP(cfgname, core_id, cache_type, associativity, blocksize, dynamic_cast<CacheSetInfoDRRIP*>(set_info));
+
+      case CacheBase::SHIP:
+         return new CacheSetSHiP(cfgname, core_id, cache_type, associativity, blocksize, dynamic_cast<CacheSetInfoSHiP*>(set_info));
+
       default:
          LOG_PRINT_ERROR("Unrecognized Cache Replacement Policy: %i",
                policy);
@@ -186,6 +259,10 @@ CacheSet::createCacheSetInfo(String name, String cfgname, core_id_t core_id, Str
       case CacheBase::SRRIP:
       case CacheBase::SRRIP_QBS:
          return new CacheSetInfoLRU(name, cfgname, core_id, associativity, getNumQBSAttempts(policy, cfgname, core_id));
+      case CacheBase::DRRIP:
+         return new CacheSetInfoDRRIP(name, cfgname, core_id, associativity);
+      case CacheBase::SHIP:
+         return new CacheSetInfoSHiP(name, cfgname, core_id, associativity);
       default:
          return NULL;
    }
@@ -227,13 +304,37 @@ CacheSet::parsePolicyType(String policy)
       return CacheBase::SRRIP_QBS;
    if (policy == "random")
       return CacheBase::RANDOM;
+   if (policy == "drrip")
+      return CacheBase::DRRIP;
+   if (policy == "ship")
+      return CacheBase::SHIP;
 
    LOG_PRINT_ERROR("Unknown replacement policy %s", policy.c_str());
 }
 
+bool CacheSet::supportsPartitioning(CacheBase::ReplacementPolicy policy)
+{
+   switch(policy)
+   {
+      case CacheBase::LRU:
+      case CacheBase::LRU_QBS:
+      case CacheBase::SRRIP:
+      case CacheBase::SRRIP_QBS:
+      case CacheBase::DRRIP:
+      case CacheBase::SHIP:
+         return true;
+      default:
+         return false;
+   }
+}
+
 bool CacheSet::isValidReplacement(UInt32 index)
 {
-   if (m_cache_block_info_array[index]->getCState() == CacheState::SHARED_UPGRADING)
+   if (index < 64 && !((m_allowed_ways >> index) & 1))
+   {
+      return false;
+   }
+   else if (m_cache_block_info_array[index]->getCState() == CacheState::SHARED_UPGRADING)
    {
       return false;
    }
@@ -27,16 +27,33 @@ class CacheSet
       static CacheSetInfo* createCacheSetInfo(String name, String cfgname, core_id_t core_id, String replacement_policy, UInt32 associativity);
       static CacheBase::ReplacementPolicy parsePolicyType(String policy);
       static UInt8 getNumQBSAttempts(CacheBase::ReplacementPolicy, String cfgname, core_id_t core_id);
+      // Whether getReplacementIndex() honors the way mask passed to insert()
+      static bool supportsPartitioning(CacheBase::ReplacementPolicy policy);
+
+      static const UInt64 ALL_WAYS = ~UInt64(0);
 
    protected:
       CacheBlockInfo** m_cache_block_info_array;
+      // Tags of all ways, contiguous and aligned so find() can compare several ways per instruction.
+      // The blocks in m_cache_block_info_array keep their tag here (CacheBlockInfo::bindTag).
+      IntPtr* m_tags;
       char* m_blocks;
+      CacheBase::cache_t m_cache_type;
       UInt32 m_associativity;
       UInt32 m_blocksize;
       Lock m_lock;
+      // Ways the line currently being inserted may replace (way partitioning), only set during evictLine.
+      // Policies that support partitioning see it through isValidReplacement().
+      UInt64 m_allowed_ways;
 
-   public:
+      SInt32 findIndex(IntPtr tag) const;
+      UInt32 evictLine(bool* eviction, CacheBlockInfo* evict_block_info, Byte* evict_buff, CacheCntlr *cntlr, UInt64 way_mask = ALL_WAYS);
 
+      // Called once a new line for <tag> has been placed in way <index>,
+      // for policies that decide the insertion position based on what is being inserted
+      virtual void notifyInsert(UInt32 index, IntPtr tag) {}
+
+   public:
       CacheSet(CacheBase::cache_t cache_type,
             UInt32 associativity, UInt32 blocksize);
       virtual ~CacheSet();
@@ -50,6 +67,9 @@ class CacheSet
       CacheBlockInfo* find(IntPtr tag, UInt32* line_index = NULL);
       bool invalidate(IntPtr& tag);
       void insert(CacheBlockInfo* cache_block_info, Byte* fill_buff, bool* eviction, CacheBlockInfo* evict_block_info, Byte* evict_buff, CacheCntlr *cntlr = NULL);
+      // Insert a new line for tag by resetting the victim way in place, returns the way used
+      // Only ways set in way_mask are considered for replacement, when the replacement policy supports partitioning
+      UInt32 insert(IntPtr tag, CacheState::cstate_t cstate, Byte* fill_buff, bool* eviction, CacheBlockInfo* evict_block_info, Byte* evict_buff, CacheCntlr *cntlr = NULL, UInt64 way_mask = ALL_WAYS);
 
       CacheBlockInfo* peekBlock(UInt32 way) const { return m_cache_block_info_array[way]; }
 
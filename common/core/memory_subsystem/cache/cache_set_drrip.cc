@@ -0,0 +1,86 @@
+#include "cache_set_drrip.h"
+#include "simulator.h"
+#include "config.hpp"
+#include "stats.h"
+#include "log.h"
+
+// DRRIP: Dynamic Re-reference Interval Prediction policy
+
+// Leader sets: in every 32 consecutive sets, one set is dedicated to SRRIP and one to BRRIP (complement-select).
+// Set index bits [4:0] give the offset in the group, bits [9:5] the group number modulo 32; the SRRIP leader
+// is at offset == group, the BRRIP leader at offset == 31 - group, so their position rotates over 32 groups.
+static const UInt32 LEADER_STRIDE_BITS = 5;
+
+CacheSetInfoDRRIP::CacheSetInfoDRRIP(String name, String cfgname, core_id_t core_id, UInt32 associativity)
+   : CacheSetInfoLRU(name, cfgname, core_id, associativity, 1)
+   , m_num_sets(0)
+   , m_psel_max((1 << Sim()->getCfg()->getIntArray(cfgname + "/drrip/psel_bits", core_id)) - 1)
+   , m_brrip_epsilon(Sim()->getCfg()->getIntArray(cfgname + "/drrip/brrip_epsilon", core_id))
+   , m_psel(m_psel_max / 2)
+   , m_brrip_count(0)
+   , m_leader_misses_srrip(0)
+   , m_leader_misses_brrip(0)
+{
+   LOG_ASSERT_ERROR(m_brrip_epsilon > 0, "%s/drrip/brrip_epsilon must be larger than zero", cfgname.c_str());
+
+   registerStatsMetric(name, core_id, "drrip-psel", &m_psel);
+   registerStatsMetric(name, core_id, "drrip-leader-misses-srrip", &m_leader_misses_srrip);
+   registerStatsMetric(name, core_id, "drrip-leader-misses-brrip", &m_leader_misses_brrip);
+}
+
+CacheSetInfoDRRIP::set_role_t
+CacheSetInfoDRRIP::assignRole()
+{
+   UInt64 set_index = m_num_sets++;
+   UInt64 offset = set_index & ((1 << LEADER_STRIDE_BITS) - 1);
+   UInt64 group = (set_index >> LEADER_STRIDE_BITS) & ((1 << LEADER_STRIDE_BITS) - 1);
+
+   if (group == offset)
+      return LEADER_SRRIP;
+   else if (group == ((1 << LEADER_STRIDE_BITS) - 1) - offset)
+      return LEADER_BRRIP;
+   else
+      return FOLLOWER;
+}
+
+void
+CacheSetInfoDRRIP::leaderMiss(set_role_t role)
+{
+   if (role == LEADER_SRRIP)
+   {
+      ++m_leader_misses_srrip;
+      if (m_psel < m_psel_max)
+         ++m_psel;
+   }
+   else if (role == LEADER_BRRIP)
+   {
+      ++m_leader_misses_brrip;
+      if (m_psel > 0)
+         --m_psel;
+   }
+}
+
+CacheSetDRRIP::CacheSetDRRIP(
+      String cfgname, core_id_t core_id,
+      CacheBase::cache_t cache_type,
+      UInt32 associativity, UInt32 blocksize, CacheSetInfoDRRIP* set_info)
+   : CacheSetSRRIP(cfgname, core_id, cache_type, associativity, blocksize, set_info, 1)
+   , m_drrip_info(set_info)
+   , m_role(set_info->assignRole())
+{
+}
+
+void
+CacheSetDRRIP::notifyInsert(UInt32 index, IntPtr tag)
+{
+   // Every insertion is a miss, leader sets use them to train PSEL
+   m_drrip_info->leaderMiss(m_role);
+
+   bool brrip = m_role == CacheSetInfoDRRIP::LEADER_BRRIP
+      || (m_role == CacheSetInfoDRRIP::FOLLOWER && m_drrip_info->followBRRIP());
+
+   if (brrip && !m_drrip_info->brripIntermediate())
+      m_rrip_bits[index] = m_rrip_max;
+   else
+      m_rrip_bits[index] = m_rrip_insert;
+}
@@ -0,0 +1,55 @@
+#ifndef CACHE_SET_DRRIP_H
+#define CACHE_SET_DRRIP_H
+
+#include "cache_set_srrip.h"
+
+// Per-cache DRRIP state: the policy selector (PSEL) trained by the leader sets
+class CacheSetInfoDRRIP : public CacheSetInfoLRU
+{
+   public:
+      enum set_role_t
+      {
+         FOLLOWER,
+         LEADER_SRRIP,
+         LEADER_BRRIP,
+      };
+
+      CacheSetInfoDRRIP(String name, String cfgname, core_id_t core_id, UInt32 associativity);
+      virtual ~CacheSetInfoDRRIP() {}
+
+      // Sets are created in index order, each one asks for its role when constructed
+      set_role_t assignRole();
+      void leaderMiss(set_role_t role);
+      // Followers use BRRIP when the SRRIP leaders miss more often
+      bool followBRRIP() const { return m_psel > m_psel_max / 2; }
+      // BRRIP inserts at the intermediate position only once every m_brrip_epsilon insertions
+      bool brripIntermediate() { return ++m_brrip_count % m_brrip_epsilon == 0; }
+
+   private:
+      UInt64 m_num_sets;
+      const UInt64 m_psel_max;
+      const UInt64 m_brrip_epsilon;
+      UInt64 m_psel;
+      UInt64 m_brrip_count;
+      UInt64 m_leader_misses_srrip;
+      UInt64 m_leader_misses_brrip;
+};
+
+// Dynamic RRIP [Jaleel et al., ISCA'10]: set dueling between SRRIP insertion (intermediate re-reference)
+// and bimodal BRRIP insertion (mostly distant re-reference), which protects the cache against thrashing
+class CacheSetDRRIP : public CacheSetSRRIP
+{
+   public:
+      CacheSetDRRIP(String cfgname, core_id_t core_id,
+            CacheBase::cache_t cache_type,
+            UInt32 associativity, UInt32 blocksize, CacheSetInfoDRRIP* set_info);
+
+   protected:
+      void notifyInsert(UInt32 index, IntPtr tag);
+
+   private:
+      CacheSetInfoDRRIP* m_drrip_info;
+      const CacheSetInfoDRRIP::set_role_t m_role;
+};
+
+#endif /* CACHE_SET_DRRIP_H */
@@ -9,16 +9,13 @@ CacheSetLRU::CacheSetLRU(
       UInt32 associativity, UInt32 blocksize, CacheSetInfoLRU* set_info, UInt8 num_attempts)
    : CacheSet(cache_type, associativity, blocksize)
    , m_num_attempts(num_attempts)
+   , m_lru_bits(associativity)
    , m_set_info(set_info)
 {
-   m_lru_bits = new UInt8[m_associativity];
-   for (UInt32 i = 0; i < m_associativity; i++)
-      m_lru_bits[i] = i;
 }
 
 CacheSetLRU::~CacheSetLRU()
 {
-   delete [] m_lru_bits;
 }
 
 UInt32
@@ -27,7 +24,7 @@ CacheSetLRU::getReplacementIndex(CacheCntlr *cntlr)
    // First try to find an invalid block
    for (UInt32 i = 0; i < m_associativity; i++)
    {
-      if (!m_cache_block_info_array[i]->isValid())
+      if (!m_cache_block_info_array[i]->isValid() && isValidReplacement(i))
       {
          // Mark our newly-inserted line as most-recently used
          moveToMRU(i);
@@ -38,11 +35,11 @@ CacheSetLRU::getReplacementIndex(CacheCntlr *cntlr)
    // Make m_num_attemps attempts at evicting the block at LRU position
    for(UInt8 attempt = 0; attempt < m_num_attempts; ++attempt)
    {
-      UInt32 index = 0;
+      UInt32 index = m_associativity;
       UInt8 max_bits = 0;
       for (UInt32 i = 0; i < m_associativity; i++)
       {
-         if (m_lru_bits[i] > max_bits && isValidReplacement(i))
+         if (isValidReplacement(i) && (index == m_associativity || m_lru_bits[i] > max_bits))
          {
             index = i;
             max_bits = m_lru_bits[i];
@@ -87,12 +84,7 @@ CacheSetLRU::updateReplacementIndex(UInt32 accessed_index)
 void
 CacheSetLRU::moveToMRU(UInt32 accessed_index)
 {
-   for (UInt32 i = 0; i < m_associativity; i++)
-   {
-      if (m_lru_bits[i] < m_lru_bits[accessed_index])
-         m_lru_bits[i] ++;
-   }
-   m_lru_bits[accessed_index] = 0;
+   m_lru_bits.moveToMRU(accessed_index);
 }
 
 CacheSetInfoLRU::CacheSetInfoLRU(String name, String cfgname, core_id_t core_id, UInt32 associativity, UInt8 num_attempts)
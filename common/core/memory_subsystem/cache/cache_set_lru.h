@@ -2,6 +2,7 @@
 #define CACHE_SET_LRU_H
 
 #include "cache_set.h"
+#include "lru_bits.h"
 
 class CacheSetInfoLRU : public CacheSetInfo
 {
@@ -20,6 +21,7 @@ class CacheSetInfoLRU : public CacheSetInfo
          else
             LOG_ASSERT_ERROR(attempt == 0, "No place to store attempt# histogram but attempt != 0");
       }
+      UInt64 getAccesses(UInt32 index) const { return m_access[index]; }
    private:
       const UInt32 m_associativity;
       UInt64* m_access;
@@ -38,7 +40,7 @@ class CacheSetLRU : public CacheSet
 
    protected:
       const UInt8 m_num_attempts;
-      UInt8* m_lru_bits;
+      LRUBits m_lru_bits;
       CacheSetInfoLRU* m_set_info;
       void moveToMRU(UInt32 accessed_index);
 };
@@ -6,16 +6,13 @@
 CacheSetMRU::CacheSetMRU(
       CacheBase::cache_t cache_type,
       UInt32 associativity, UInt32 blocksize) :
-   CacheSet(cache_type, associativity, blocksize)
+   CacheSet(cache_type, associativity, blocksize),
+   m_lru_bits(associativity)
 {
-   m_lru_bits = new UInt8[m_associativity];
-   for (UInt32 i = 0; i < m_associativity; i++)
-      m_lru_bits[i] = i;
 }
 
 CacheSetMRU::~CacheSetMRU()
 {
-   delete [] m_lru_bits;
 }
 
 UInt32
@@ -52,10 +49,5 @@ CacheSetMRU::getReplacementIndex(CacheCntlr *cntlr)
 void
 CacheSetMRU::updateReplacementIndex(UInt32 accessed_index)
 {
-   for (UInt32 i = 0; i < m_associativity; i++)
-   {
-      if (m_lru_bits[i] < m_lru_bits[accessed_index])
-         m_lru_bits[i] ++;
-   }
-   m_lru_bits[accessed_index] = 0;
+   m_lru_bits.moveToMRU(accessed_index);
 }
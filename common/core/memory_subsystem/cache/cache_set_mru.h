@@ -2,6 +2,7 @@
 #define CACHE_SET_MRU_H
 
 #include "cache_set.h"
+#include "lru_bits.h"
 
 class CacheSetMRU : public CacheSet
 {
@@ -14,7 +15,7 @@ class CacheSetMRU : public CacheSet
       void updateReplacementIndex(UInt32 accessed_index);
 
    private:
-      UInt8* m_lru_bits;
+      LRUBits m_lru_bits;
 };
 
 #endif /* CACHE_SET_MRU_H */
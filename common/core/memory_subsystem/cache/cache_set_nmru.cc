@@ -6,18 +6,14 @@
 CacheSetNMRU::CacheSetNMRU(
       CacheBase::cache_t cache_type,
       UInt32 associativity, UInt32 blocksize) :
-   CacheSet(cache_type, associativity, blocksize)
+   CacheSet(cache_type, associativity, blocksize),
+   m_lru_bits(associativity)
 {
-   m_lru_bits = new UInt8[m_associativity];
-   for (UInt32 i = 0; i < m_associativity; i++)
-      m_lru_bits[i] = i;
-
    m_replacement_pointer = 0;
 }
 
 CacheSetNMRU::~CacheSetNMRU()
 {
-   delete [] m_lru_bits;
 }
 
 UInt32
@@ -54,10 +50,5 @@ CacheSetNMRU::getReplacementIndex(CacheCntlr *cntlr)
 void
 CacheSetNMRU::updateReplacementIndex(UInt32 accessed_index)
 {
-   for (UInt32 i = 0; i < m_associativity; i++)
-   {
-      if (m_lru_bits[i] < m_lru_bits[accessed_index])
-         m_lru_bits[i]++;
-   }
-   m_lru_bits[accessed_index] = 0;
+   m_lru_bits.moveToMRU(accessed_index);
 }
@@ -2,6 +2,7 @@
 #define CACHE_SET_NMRU_H
 
 #include "cache_set.h"
+#include "lru_bits.h"
 
 class CacheSetNMRU : public CacheSet
 {
@@ -14,7 +15,7 @@ class CacheSetNMRU : public CacheSet
       void updateReplacementIndex(UInt32 accessed_index);
 
    private:
-      UInt8* m_lru_bits;
+      LRUBits m_lru_bits;
       UInt8  m_replacement_pointer;
 };
 
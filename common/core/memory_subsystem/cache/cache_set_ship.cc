@@ -0,0 +1,118 @@
+#include "cache_set_ship.h"
+#include "simulator.h"
+#include "config.hpp"
+#include "stats.h"
+#include "log.h"
+
+// SHiP: Signature-based Hit Predictor
+
+CacheSetInfoSHiP::CacheSetInfoSHiP(String name, String cfgname, core_id_t core_id, UInt32 associativity)
+   : CacheSetInfoLRU(name, cfgname, core_id, associativity, 1)
+   , m_shct(Sim()->getCfg()->getIntArray(cfgname + "/ship/shct_size", core_id))
+   , m_counter_max((1 << Sim()->getCfg()->getIntArray(cfgname + "/ship/counter_bits", core_id)) - 1)
+   , m_inserts_distant(0)
+   , m_inserts_intermediate(0)
+   , m_evictions_unused(0)
+{
+   LOG_ASSERT_ERROR(m_shct.size() > 0 && (m_shct.size() & (m_shct.size() - 1)) == 0,
+      "%s/ship/shct_size must be a power of two", cfgname.c_str());
+
+   // Start out weakly predicting re-reference, so SHiP behaves like SRRIP until it has learned
+   for(UInt32 i = 0; i < m_shct.size(); ++i)
+      m_shct[i] = 1;
+
+   registerStatsMetric(name, core_id, "ship-inserts-distant", &m_inserts_distant);
+   registerStatsMetric(name, core_id, "ship-inserts-intermediate", &m_inserts_intermediate);
+   registerStatsMetric(name, core_id, "ship-evictions-unused", &m_evictions_unused);
+}
+
+UInt32
+CacheSetInfoSHiP::getSignature(IntPtr tag) const
+{
+   // Multiplicative hash, the table index is taken from the well-mixed upper bits
+   UInt64 hash = UInt64(tag) * 0x9e3779b97f4a7c15ULL;
+   return (hash >> 32) & (m_shct.size() - 1);
+}
+
+void
+CacheSetInfoSHiP::train(UInt32 signature, bool reused)
+{
+   if (reused)
+   {
+      if (m_shct[signature] < m_counter_max)
+         ++m_shct[signature];
+   }
+   else
+   {
+      ++m_evictions_unused;
+      if (m_shct[signature] > 0)
+         --m_shct[signature];
+   }
+}
+
+bool
+CacheSetInfoSHiP::predictDistant(UInt32 signature)
+{
+   if (m_shct[signature] == 0)
+   {
+      ++m_inserts_distant;
+      return true;
+   }
+   else
+   {
+      ++m_inserts_intermediate;
+      return false;
+   }
+}
+
+CacheSetSHiP::CacheSetSHiP(
+      String cfgname, core_id_t core_id,
+      CacheBase::cache_t cache_type,
+      UInt32 associativity, UInt32 blocksize, CacheSetInfoSHiP* set_info)
+   : CacheSetSRRIP(cfgname, core_id, cache_type, associativity, blocksize, set_info, 1)
+   , m_ship_info(set_info)
+{
+   m_signature = new UInt32[m_associativity];
+   m_reused = new bool[m_associativity];
+   m_tracked = new bool[m_associativity];
+   for (UInt32 i = 0; i < m_associativity; i++)
+   {
+      m_signature[i] = 0;
+      m_reused[i] = false;
+      m_tracked[i] = false;
+   }
+}
+
+CacheSetSHiP::~CacheSetSHiP()
+{
+   delete [] m_signature;
+   delete [] m_reused;
+   delete [] m_tracked;
+}
+
+void
+CacheSetSHiP::updateReplacementIndex(UInt32 accessed_index)
+{
+   CacheSetSRRIP::updateReplacementIndex(accessed_index);
+
+   if (m_tracked[accessed_index])
+   {
+      m_reused[accessed_index] = true;
+      m_ship_info->train(m_signature[accessed_index], true);
+   }
+}
+
+void
+CacheSetSHiP::notifyInsert(UInt32 index, IntPtr tag)
+{
+   // The previous line in this way is gone: if it was never re-referenced, its signature predicted wrong
+   // (lines that were invalidated rather than evicted are counted here too)
+   if (m_tracked[index] && !m_reused[index])
+      m_ship_info->train(m_signature[index], false);
+
+   m_signature[index] = m_ship_info->getSignature(tag);
+   m_reused[index] = false;
+   m_tracked[index] = true;
+
+   m_rrip_bits[index] = m_ship_info->predictDistant(m_signature[index]) ? m_rrip_max : m_rrip_insert;
+}
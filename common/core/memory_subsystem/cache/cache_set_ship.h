@@ -0,0 +1,52 @@
+#ifndef CACHE_SET_SHIP_H
+#define CACHE_SET_SHIP_H
+
+#include "cache_set_srrip.h"
+
+#include <vector>
+
+// Per-cache SHiP state: the signature history counter table (SHCT)
+class CacheSetInfoSHiP : public CacheSetInfoLRU
+{
+   public:
+      CacheSetInfoSHiP(String name, String cfgname, core_id_t core_id, UInt32 associativity);
+      virtual ~CacheSetInfoSHiP() {}
+
+      UInt32 getSignature(IntPtr tag) const;
+      // A line with this signature was re-referenced, or evicted without having been re-referenced
+      void train(UInt32 signature, bool reused);
+      // Lines whose signature saw no re-references recently are predicted to be dead on arrival
+      bool predictDistant(UInt32 signature);
+
+   private:
+      std::vector<UInt8> m_shct;
+      const UInt8 m_counter_max;
+      UInt64 m_inserts_distant;
+      UInt64 m_inserts_intermediate;
+      UInt64 m_evictions_unused;
+};
+
+// SHiP [Wu et al., MICRO'11] on top of SRRIP: insertion position predicted per signature.
+// No instruction pointers are available in the memory hierarchy, so this is the SHiP-Mem variant:
+// the signature is a hash of the tag, i.e. of the (num_sets * block_size)-sized memory region.
+class CacheSetSHiP : public CacheSetSRRIP
+{
+   public:
+      CacheSetSHiP(String cfgname, core_id_t core_id,
+            CacheBase::cache_t cache_type,
+            UInt32 associativity, UInt32 blocksize, CacheSetInfoSHiP* set_info);
+      ~CacheSetSHiP();
+
+      void updateReplacementIndex(UInt32 accessed_index);
+
+   protected:
+      void notifyInsert(UInt32 index, IntPtr tag);
+
+   private:
+      CacheSetInfoSHiP* m_ship_info;
+      UInt32* m_signature;
+      bool* m_reused;
+      bool* m_tracked;     // Way holds a line inserted by us, so its signature can be trained on eviction
+};
+
+#endif /* CACHE_SET_SHIP_H */
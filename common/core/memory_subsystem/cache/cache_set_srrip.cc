@@ -32,7 +32,7 @@ CacheSetSRRIP::getReplacementIndex(CacheCntlr *cntlr)
 {
    for (UInt32 i = 0; i < m_associativity; i++)
    {
-      if (!m_cache_block_info_array[i]->isValid())
+      if (!m_cache_block_info_array[i]->isValid() && isValidReplacement(i))
       {
          // If there is an invalid line(s) in the set, regardless of the LRU bits of other lines, we choose the first invalid line to replace
          // Prepare way for a new line: set prediction to 'long'
@@ -47,7 +47,7 @@ CacheSetSRRIP::getReplacementIndex(CacheCntlr *cntlr)
    {
       for (UInt32 i = 0; i < m_associativity; i++)
       {
-         if (m_rrip_bits[m_replacement_pointer] >= m_rrip_max)
+         if (m_rrip_bits[m_replacement_pointer] >= m_rrip_max && isValidReplacement(m_replacement_pointer))
          {
             // We choose the first non-touched line as the victim (note that we start searching from the replacement pointer position)
             UInt8 index = m_replacement_pointer;
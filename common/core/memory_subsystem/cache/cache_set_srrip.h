@@ -15,7 +15,7 @@ class CacheSetSRRIP : public CacheSet
       UInt32 getReplacementIndex(CacheCntlr *cntlr);
       void updateReplacementIndex(UInt32 accessed_index);
 
-   private:
+   protected:
       const UInt8 m_rrip_numbits;
       const UInt8 m_rrip_max;
       const UInt8 m_rrip_insert;
@@ -0,0 +1,67 @@
+#ifndef LRU_BITS_H
+#define LRU_BITS_H
+
+#include "fixed_types.h"
+#include "log.h"
+
+#include <cstdlib>
+
+#if defined(__x86_64__) && defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+// Recency ranks for LRU-stack based policies: 0 is most recently used, associativity-1 least recently used.
+// Ranks are stored padded to whole 16-byte vectors, padding lanes hold a rank no real way can reach
+// (there only are padding lanes when associativity is not a multiple of 16, so up to 256 ways are supported).
+// Moving a way to MRU then ages all ways with one compare and one subtract per 16 ways,
+// instead of a compare-and-branch per way.
+class LRUBits
+{
+   public:
+      LRUBits(UInt32 associativity)
+         : m_num_lanes((associativity + LANES - 1) / LANES * LANES)
+      {
+         LOG_ASSERT_ERROR(associativity <= 256, "Associativity %u too large for LRU bits", associativity);
+         int res = posix_memalign((void**)&m_bits, LANES, m_num_lanes);
+         LOG_ASSERT_ERROR(res == 0, "Could not allocate LRU bits");
+         for (UInt32 i = 0; i < m_num_lanes; i++)
+            m_bits[i] = i < associativity ? i : PADDING;
+      }
+      ~LRUBits() { free(m_bits); }
+
+      UInt8 operator[](UInt32 index) const { return m_bits[index]; }
+
+      // Ways more recent than <index> age by one, <index> becomes MRU
+      void moveToMRU(UInt32 index)
+      {
+#if defined(__x86_64__) && defined(__SSE2__)
+         // SSE2 only has signed byte compares: flipping the top bit of both sides makes them compare unsigned
+         const __m128i bias = _mm_set1_epi8((char)0x80);
+         const __m128i rank = _mm_xor_si128(_mm_set1_epi8(m_bits[index]), bias);
+         for (UInt32 i = 0; i < m_num_lanes; i += LANES)
+         {
+            __m128i bits = _mm_load_si128((const __m128i*)&m_bits[i]);
+            // Lanes with a smaller rank compare as -1, subtracting that adds one
+            bits = _mm_sub_epi8(bits, _mm_cmplt_epi8(_mm_xor_si128(bits, bias), rank));
+            _mm_store_si128((__m128i*)&m_bits[i], bits);
+         }
+#else
+         const UInt8 rank = m_bits[index];
+         for (UInt32 i = 0; i < m_num_lanes; i++)
+            m_bits[i] += (m_bits[i] < rank);
+#endif
+         m_bits[index] = 0;
+      }
+
+   private:
+      static const UInt32 LANES = 16;
+      static const UInt8 PADDING = 0xff;
+
+      UInt8* m_bits;
+      const UInt32 m_num_lanes;
+
+      LRUBits(const LRUBits&);
+      LRUBits& operator=(const LRUBits&);
+};
+
+#endif /* LRU_BITS_H */
@@ -4,82 +4,206 @@
 #include "config.hpp"
 #include "core_manager.h"
 #include "hooks_manager.h"
+#include "host_perf_counters.h"
 #include "stats.h"
 
+#include <algorithm>
+#include <sched.h>
+
 CheetahManager::CheetahStats *CheetahManager::s_cheetah_stats = NULL;
 std::vector<std::vector<CheetahModel*> > CheetahManager::s_cheetah_models(NUM_CHEETAH_TYPES);
+std::vector<CheetahManager*> CheetahManager::s_cheetah_managers;
 const char* CheetahManager::cheetah_names[] = { "local", "by-2", "by-4", "by-8", "global" };
 
 CheetahManager::CheetahManager(core_id_t core_id)
    : m_min_bits(Sim()->getCfg()->getInt("core/cheetah/min_size_bits"))
    , m_max_bits_local(Sim()->getCfg()->getInt("core/cheetah/max_size_bits_local"))
    , m_max_bits_global(Sim()->getCfg()->getInt("core/cheetah/max_size_bits_global"))
+   , m_associativity_bits(Sim()->getCfg()->getInt("core/cheetah/associativity_bits"))
    , m_address_buffer_size(0)
+   , m_produced(0)
+   , m_consumed(0)
+   , m_producer_waiting(false)
+   , m_consumer_waiting(false)
+   , m_quit(false)
+   , m_thread(NULL)
+   , m_num_stalls(0)
 {
-   LOG_ASSERT_ERROR(m_min_bits >= CheetahModel::getMinSize(),
+   LOG_ASSERT_ERROR(m_min_bits >= CheetahModel::getMinSize(m_associativity_bits),
       "cheetah/min_size_bits (%d) must be >= %d",
-      m_min_bits, CheetahModel::getMinSize());
-   LOG_ASSERT_ERROR(m_max_bits_local >= CheetahModel::getMinSize(),
+      m_min_bits, CheetahModel::getMinSize(m_associativity_bits));
+   LOG_ASSERT_ERROR(m_max_bits_local >= m_min_bits,
       "cheetah/max_size_bits_local (%d) must be >= %d",
-      m_max_bits_local, CheetahModel::getMinSize());
-   LOG_ASSERT_ERROR(m_max_bits_global >= CheetahModel::getMinSize(),
+      m_max_bits_local, m_min_bits);
+   LOG_ASSERT_ERROR(m_max_bits_global >= m_min_bits,
       "cheetah/max_size_bits_global (%d) must be >= %d",
-      m_max_bits_global, CheetahModel::getMinSize());
+      m_max_bits_global, m_min_bits);
+
+   bool threaded = Sim()->getCfg()->getBool("core/cheetah/threaded");
 
    if (!s_cheetah_stats)
-      s_cheetah_stats = new CheetahStats(m_min_bits, m_max_bits_local, m_max_bits_global);
+      s_cheetah_stats = new CheetahStats(m_min_bits, m_max_bits_local, m_max_bits_global, m_associativity_bits);
 
-   s_cheetah_models[CHEETAH_LOCAL].push_back(new CheetahModel(false, m_min_bits, m_max_bits_local));
-   if ((core_id & 1) == 0) s_cheetah_models[CHEETAH_BY2].push_back(new CheetahModel(true, m_min_bits, m_max_bits_local));
-   if ((core_id & 3) == 0) s_cheetah_models[CHEETAH_BY4].push_back(new CheetahModel(true, m_min_bits, m_max_bits_local));
-   if ((core_id & 7) == 0) s_cheetah_models[CHEETAH_BY8].push_back(new CheetahModel(true, m_min_bits, m_max_bits_local));
-   if (core_id == 0)       s_cheetah_models[CHEETAH_GLOBAL].push_back(new CheetahModel(true, m_min_bits, m_max_bits_global));
+   // Models updated from a background thread are locked, so statistics can be read while they are being updated
+   s_cheetah_models[CHEETAH_LOCAL].push_back(new CheetahModel(threaded, m_associativity_bits, m_min_bits, m_max_bits_local));
+   if ((core_id & 1) == 0) s_cheetah_models[CHEETAH_BY2].push_back(new CheetahModel(true, m_associativity_bits, m_min_bits, m_max_bits_local));
+   if ((core_id & 3) == 0) s_cheetah_models[CHEETAH_BY4].push_back(new CheetahModel(true, m_associativity_bits, m_min_bits, m_max_bits_local));
+   if ((core_id & 7) == 0) s_cheetah_models[CHEETAH_BY8].push_back(new CheetahModel(true, m_associativity_bits, m_min_bits, m_max_bits_local));
+   if (core_id == 0)       s_cheetah_models[CHEETAH_GLOBAL].push_back(new CheetahModel(true, m_associativity_bits, m_min_bits, m_max_bits_global));
 
    m_cheetah[CHEETAH_LOCAL] = s_cheetah_models[CHEETAH_LOCAL].back();
    m_cheetah[CHEETAH_BY2] = s_cheetah_models[CHEETAH_BY2].back();
    m_cheetah[CHEETAH_BY4] = s_cheetah_models[CHEETAH_BY4].back();
    m_cheetah[CHEETAH_BY8] = s_cheetah_models[CHEETAH_BY8].back();
    m_cheetah[CHEETAH_GLOBAL] = s_cheetah_models[CHEETAH_GLOBAL].back();
+
+   s_cheetah_managers.push_back(this);
+
+   if (threaded)
+   {
+      registerStatsMetric("core", core_id, "cheetah-handoff-stalls", &m_num_stalls);
+      m_thread = _Thread::create(this);
+      m_thread->run();
+   }
 }
 
 CheetahManager::~CheetahManager()
 {
+   if (m_thread)
+   {
+      // The worker processes all published blocks before exiting
+      m_quit = true;
+      __sync_synchronize();
+      m_sem_work.signal();
+      m_sem_exited.wait();
+      delete m_thread;
+   }
+   s_cheetah_managers.erase(std::find(s_cheetah_managers.begin(), s_cheetah_managers.end(), this));
 }
 
 void CheetahManager::access(Core::mem_op_t mem_op_type, IntPtr address)
 {
-   m_address_buffer[m_address_buffer_size++] = address;
+   m_blocks[m_produced % NUM_BLOCKS].addresses[m_address_buffer_size++] = address;
 
    if (m_address_buffer_size >= ADDRESS_BUFFER_SIZE)
+      handOff();
+}
+
+void CheetahManager::handOff()
+{
+   m_address_buffer_size = 0;
+
+   if (!m_thread)
+   {
+      process(m_blocks[m_produced % NUM_BLOCKS]);
+      return;
+   }
+
+   // Publish the block: its contents must be visible before the new count
+   __sync_synchronize();
+   ++m_produced;
+   __sync_synchronize();
+   if (m_consumer_waiting)
+      m_sem_work.signal();
+
+   // Make sure the next block has been consumed before we start filling it
+   if (m_produced - m_consumed >= NUM_BLOCKS)
    {
-      for(unsigned int idx = 0; idx < NUM_CHEETAH_TYPES; ++idx)
-         m_cheetah[idx]->accesses(m_address_buffer, m_address_buffer_size);
-      m_address_buffer_size = 0;
+      ++m_num_stalls;
+      while (true)
+      {
+         m_producer_waiting = true;
+         __sync_synchronize();
+         if (m_produced - m_consumed < NUM_BLOCKS)
+            break;
+         m_sem_space.wait();
+      }
+      m_producer_waiting = false;
    }
 }
 
-CheetahManager::CheetahStats::CheetahStats(UInt32 min_bits, UInt32 max_bits_local, UInt32 max_bits_global)
+void CheetahManager::process(const AddressBlock &block)
+{
+   for(unsigned int idx = 0; idx < NUM_CHEETAH_TYPES; ++idx)
+      m_cheetah[idx]->accesses(block.addresses, ADDRESS_BUFFER_SIZE);
+}
+
+void CheetahManager::run()
+{
+   HostPerfCounters::registerThread("cheetah");
+
+   while (true)
+   {
+      while (m_consumed == m_produced)
+      {
+         if (m_quit)
+         {
+            m_sem_exited.signal();
+            return;
+         }
+         m_consumer_waiting = true;
+         __sync_synchronize();
+         if (m_consumed == m_produced && !m_quit)
+            m_sem_work.wait();
+         m_consumer_waiting = false;
+      }
+
+      // Pairs with the barrier before the producer published this block
+      __sync_synchronize();
+      process(m_blocks[m_consumed % NUM_BLOCKS]);
+      __sync_synchronize();
+      ++m_consumed;
+      __sync_synchronize();
+      if (m_producer_waiting)
+         m_sem_space.signal();
+   }
+}
+
+void CheetahManager::drain()
+{
+   // Wait until all blocks published so far have been processed.
+   // Only used when writing statistics, so polling is good enough.
+   UInt64 produced = m_produced;
+   while (m_thread && m_consumed < produced)
+      sched_yield();
+}
+
+CheetahManager::CheetahStats::CheetahStats(UInt32 min_bits, UInt32 max_bits_local, UInt32 max_bits_global, UInt32 associativity_bits)
    : m_min_bits(min_bits)
    , m_max_bits_local(max_bits_local)
    , m_max_bits_global(max_bits_global)
+   , m_associativity_bits(associativity_bits)
 {
    m_stats.resize(NUM_CHEETAH_TYPES);
    for(unsigned int idx = 0; idx < NUM_CHEETAH_TYPES; ++idx)
    {
       UInt32 max_bits = (idx == CHEETAH_GLOBAL ? max_bits_global : max_bits_local);
-      m_stats[idx].resize(max_bits + 1);
-      for(UInt32 size = 0; size < max_bits; ++size)
-         registerStatsMetric("cheetah", size, cheetah_names[idx], &m_stats[idx][size]);
+      m_stats[idx].resize(associativity_bits + 1);
+      for(UInt32 assoc_bits = 0; assoc_bits <= associativity_bits; ++assoc_bits)
+      {
+         // The full associativity keeps the plain model name, lower associativities get a -<N>way suffix
+         String name = cheetah_names[idx];
+         if (assoc_bits < associativity_bits)
+            name += "-" + itostr(1 << assoc_bits) + "way";
+
+         m_stats[idx][assoc_bits].resize(max_bits + 1);
+         for(UInt32 size = 0; size < max_bits; ++size)
+            registerStatsMetric("cheetah", size, name, &m_stats[idx][assoc_bits][size]);
+      }
    }
    Sim()->getHooksManager()->registerHook(HookType::HOOK_PRE_STAT_WRITE, hook_update, (UInt64)this, HooksManager::ORDER_NOTIFY_PRE);
 }
 
 void CheetahManager::CheetahStats::update()
 {
+   for(auto it = s_cheetah_managers.begin(); it != s_cheetah_managers.end(); ++it)
+      (*it)->drain();
+
    for(unsigned int idx = 0; idx < NUM_CHEETAH_TYPES; ++idx)
    {
-      for(UInt32 size_bits = 0; size_bits < m_stats.size(); ++size_bits)
-         m_stats[idx][size_bits] = 0;
+      for(UInt32 assoc_bits = 0; assoc_bits < m_stats[idx].size(); ++assoc_bits)
+         for(UInt32 size_bits = 0; size_bits < m_stats[idx][assoc_bits].size(); ++size_bits)
+            m_stats[idx][assoc_bits][size_bits] = 0;
       for(auto it = s_cheetah_models[idx].begin(); it != s_cheetah_models[idx].end(); ++it)
          (*it)->updateStats(m_stats[idx]);
    }
@@ -3,10 +3,18 @@
 
 #include "fixed_types.h"
 #include "core.h"
+#include "_thread.h"
+#include "semaphore.h"
 
 class CheetahModel;
 
-class CheetahManager
+// Collects the data addresses of a core in fixed-size blocks, and feeds them to the local and shared
+// stack distance (Cheetah) models. Each model pass yields hit counts for all cache sizes and all
+// associativities up to 2^associativity_bits at once.
+// When threaded, blocks are handed off through a single-producer single-consumer ring to a background
+// thread per core, so the core thread only stores addresses and publishes full blocks; it only blocks
+// when the ring is full.
+class CheetahManager : public Runnable
 {
    private:
       typedef enum {
@@ -25,26 +33,53 @@ class CheetahManager
             const UInt32 m_min_bits;
             const UInt32 m_max_bits_local;
             const UInt32 m_max_bits_global;
-            std::vector<std::vector<UInt64> > m_stats;
+            const UInt32 m_associativity_bits;
+            // Hit counts indexed by model type, log2(associativity) and log2(cache size)
+            std::vector<std::vector<std::vector<UInt64> > > m_stats;
 
             static SInt64 hook_update(UInt64 user, UInt64 args)
             { ((CheetahStats*)user)->update(); return 0; }
             void update();
 
          public:
-            CheetahStats(UInt32 min_bits, UInt32 max_bits_local, UInt32 max_bits_global);
+            CheetahStats(UInt32 min_bits, UInt32 max_bits_local, UInt32 max_bits_global, UInt32 associativity_bits);
       };
       static CheetahStats *s_cheetah_stats;
       static std::vector<std::vector<CheetahModel*> > s_cheetah_models;
+      static std::vector<CheetahManager*> s_cheetah_managers;
 
       const UInt32 m_min_bits;
       const UInt32 m_max_bits_local;
       const UInt32 m_max_bits_global;
+      const UInt32 m_associativity_bits;
       CheetahModel *m_cheetah[NUM_CHEETAH_TYPES];
 
       static const UInt32 ADDRESS_BUFFER_SIZE = 256;
-      IntPtr m_address_buffer[ADDRESS_BUFFER_SIZE];
+      static const UInt32 NUM_BLOCKS = 16;
+      struct AddressBlock
+      {
+         IntPtr addresses[ADDRESS_BUFFER_SIZE];
+      };
+      // The core fills m_blocks[m_produced % NUM_BLOCKS] in place, the worker consumes m_blocks[m_consumed % NUM_BLOCKS].
+      // Each counter has a single writer; the semaphores are only touched when the other side is (about to be) asleep.
+      AddressBlock m_blocks[NUM_BLOCKS];
       UInt32 m_address_buffer_size;
+      volatile UInt64 m_produced;
+      volatile UInt64 m_consumed;
+      volatile bool m_producer_waiting;
+      volatile bool m_consumer_waiting;
+      volatile bool m_quit;
+      Semaphore m_sem_work;
+      Semaphore m_sem_space;
+      Semaphore m_sem_exited;
+      _Thread *m_thread;
+
+      UInt64 m_num_stalls;          // Number of times the core found the ring full
+
+      void handOff();
+      void process(const AddressBlock &block);
+      void drain();
+      void run();
 
    public:
       CheetahManager(core_id_t core_id);
@@ -1,9 +1,10 @@
 #include "cheetah_model.h"
 
-CheetahModel::CheetahModel(bool locked, unsigned min_size_bits, unsigned max_size_bits)
-   : m_min_sets_log2(min_size_bits - associativity_log2 - line_size_log2)
-   , m_max_sets_log2(max_size_bits - associativity_log2 - line_size_log2)
-   , cheetah(associativity_log2, m_max_sets_log2, m_min_sets_log2, line_size_log2)
+CheetahModel::CheetahModel(bool locked, unsigned associativity_bits, unsigned min_size_bits, unsigned max_size_bits)
+   : m_associativity_log2(associativity_bits)
+   , m_min_sets_log2(min_size_bits - associativity_bits - line_size_log2)
+   , m_max_sets_log2(max_size_bits - associativity_bits - line_size_log2)
+   , cheetah(m_associativity_log2, m_max_sets_log2, m_min_sets_log2, line_size_log2)
    , m_locked(locked)
 {
 }
@@ -12,17 +13,27 @@ CheetahModel::~CheetahModel()
 {
 }
 
-void CheetahModel::updateStats(std::vector<UInt64> &stats)
+void CheetahModel::updateStats(std::vector<std::vector<UInt64> > &stats)
 {
-   for(unsigned sets_log2 = m_min_sets_log2; sets_log2 <= m_max_sets_log2; ++sets_log2)
+   if (m_locked)
+      m_lock.acquire();
+
+   // The GBT keeps hit counts by stack depth for every set count, so lower associativities come for free
+   for(unsigned assoc_log2 = 0; assoc_log2 <= m_associativity_log2; ++assoc_log2)
    {
-      uint64_t size_bits = associativity_log2 + sets_log2 + line_size_log2;
-      stats[size_bits] += cheetah.hits(sets_log2, 1 << associativity_log2);
+      for(unsigned sets_log2 = m_min_sets_log2; sets_log2 <= m_max_sets_log2; ++sets_log2)
+      {
+         uint64_t size_bits = assoc_log2 + sets_log2 + line_size_log2;
+         stats[assoc_log2][size_bits] += cheetah.hits(sets_log2, 1 << assoc_log2);
+      }
+      stats[assoc_log2][0] += cheetah.numentries();
    }
-   stats[0] += cheetah.numentries();
+
+   if (m_locked)
+      m_lock.release();
 }
 
-void CheetahModel::accesses(IntPtr *addrs, int count)
+void CheetahModel::accesses(const IntPtr *addrs, int count)
 {
    if (m_locked)
       m_lock.acquire();
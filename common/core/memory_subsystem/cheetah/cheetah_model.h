@@ -10,9 +10,9 @@
 class CheetahModel
 {
    private:
-      static const unsigned associativity_log2 = 4,
-                            line_size_log2 = 6;
-      const unsigned m_min_sets_log2,
+      static const unsigned line_size_log2 = 6;
+      const unsigned m_associativity_log2,
+                     m_min_sets_log2,
                      m_max_sets_log2;
       CheetahSACLRU cheetah;
       bool m_locked;
@@ -21,13 +21,15 @@ class CheetahModel
       void access(IntPtr addr);
 
    public:
-      static unsigned getMinSize() { return associativity_log2 + line_size_log2; }
+      static unsigned getMinSize(unsigned associativity_bits) { return associativity_bits + line_size_log2; }
 
-      CheetahModel(bool locked, unsigned min_size_bits, unsigned max_size_bits);
+      CheetahModel(bool locked, unsigned associativity_bits, unsigned min_size_bits, unsigned max_size_bits);
       ~CheetahModel();
 
-      void accesses(IntPtr *addrs, int count);
-      void updateStats(std::vector<UInt64> &stats);
+      void accesses(const IntPtr *addrs, int count);
+      // Add hit counts to stats[log2(associativity)][log2(cache size)], for all associativities up to the model's,
+      // and the number of accesses to stats[*][0]
+      void updateStats(std::vector<std::vector<UInt64> > &stats);
 };
 
 #endif // __CHEETAH_MODEL_H
@@ -171,7 +171,7 @@ DramCache::insertLine(Cache::access_t access, IntPtr address, core_id_t requeste
    // Writeback to DRAM done off-line, so don't affect return latency
    if (eviction && evict_block_info.getCState() == CacheState::MODIFIED)
    {
-      m_dram_cntlr->putDataToDram(evict_address, requester, data_buf, now);
+      m_dram_cntlr->putDataToDram(evict_address, requester, evict_buf, now);
    }
 }
 
@@ -8,6 +8,8 @@
 ATD::ATD(String name, String configName, core_id_t core_id, UInt32 num_sets, UInt32 associativity,
          UInt32 cache_block_size, String replacement_policy, CacheBase::hash_t hash_function)
    : m_cache_base(name, num_sets, associativity, cache_block_size, hash_function)
+   , m_sampled()
+   , m_rank()
    , m_sets()
    , loads(0)
    , stores(0)
@@ -29,21 +31,19 @@ ATD::ATD(String name, String configName, core_id_t core_id, UInt32 num_sets, UIn
    registerStatsMetric(name, core_id, "stores-constructive", &stores_constructive);
    registerStatsMetric(name, core_id, "stores-destructive", &stores_destructive);
 
+   m_sampled.resize((num_sets + 63) / 64, 0);
+
    String sampling = Sim()->getCfg()->getStringArray(configName + "/atd/sampling", core_id);
    if (sampling == "full")
    {
       for(UInt64 set_index = 0; set_index < num_sets; ++set_index)
-      {
-         m_sets[set_index] = CacheSet::createCacheSet(name, core_id, replacement_policy, CacheBase::PR_L1_CACHE, associativity, 0, m_set_info);
-      }
+         setSampled(set_index);
    }
    else if (sampling == "2^n+1")
    {
       // Sample sets at indexes 2^N+1
       for(UInt64 set_index = 1; set_index < num_sets - 1; set_index <<= 1)
-      {
-         m_sets[set_index+1] = CacheSet::createCacheSet(name, core_id, replacement_policy, CacheBase::PR_L1_CACHE, associativity, 0, m_set_info);
-      }
+         setSampled(set_index+1);
    }
    else if (sampling == "random")
    {
@@ -57,9 +57,9 @@ ATD::ATD(String name, String configName, core_id_t core_id, UInt32 num_sets, UIn
       while(num_atds)
       {
          UInt64 set_index = rng_next(state) % num_sets;
-         if (m_sets.count(set_index) == 0)
+         if (!isSampledSet(set_index))
          {
-            m_sets[set_index] = CacheSet::createCacheSet(name, core_id, replacement_policy, CacheBase::PR_L1_CACHE, associativity, 0, m_set_info);
+            setSampled(set_index);
             --num_atds;
          }
          LOG_ASSERT_ERROR(++num_attempts < 10 * num_sets, "Cound not find unique ATD sets even after many attempts");
@@ -69,19 +69,26 @@ ATD::ATD(String name, String configName, core_id_t core_id, UInt32 num_sets, UIn
    {
       LOG_PRINT_ERROR("Invalid ATD sampling method %s", sampling.c_str());
    }
+
+   // Create the sampled sets in set index order, which is the order getSampledSet() expects
+   m_rank.resize(m_sampled.size());
+   for(UInt32 word = 0; word < m_sampled.size(); ++word)
+   {
+      m_rank[word] = m_sets.size();
+      for(UInt32 bit = 0; bit < 64; ++bit)
+         if ((m_sampled[word] >> bit) & 1)
+            m_sets.push_back(CacheSet::createCacheSet(configName, core_id, replacement_policy, CacheBase::PR_L1_CACHE, associativity, 0, m_set_info));
+   }
 }
 
 ATD::~ATD()
 {
+   for(std::vector<CacheSet*>::iterator it = m_sets.begin(); it != m_sets.end(); ++it)
+      delete *it;
    if (m_set_info)
       delete m_set_info;
 }
 
-bool ATD::isSampledSet(UInt32 set_index)
-{
-   return m_sets.count(set_index);
-}
-
 void ATD::access(Core::mem_op_t mem_op_type, bool cache_hit, IntPtr address)
 {
    IntPtr tag; UInt32 set_index;
@@ -89,18 +96,18 @@ void ATD::access(Core::mem_op_t mem_op_type, bool cache_hit, IntPtr address)
 
    if (isSampledSet(set_index))
    {
+      CacheSet* set = getSampledSet(set_index);
       UInt32 line_index = -1;
-      bool atd_hit = m_sets[set_index]->find(tag, &line_index);
+      bool atd_hit = set->find(tag, &line_index);
 
       if (atd_hit)
       {
-         m_sets[set_index]->updateReplacementIndex(line_index);
+         set->updateReplacementIndex(line_index);
       }
       else
       {
-         PrL1CacheBlockInfo* cache_block_info = new PrL1CacheBlockInfo(tag, CacheState::MODIFIED);
          bool eviction; PrL1CacheBlockInfo evict_block_info;
-         m_sets[set_index]->insert(cache_block_info, NULL, &eviction, &evict_block_info, NULL);
+         set->insert(tag, CacheState::MODIFIED, NULL, &eviction, &evict_block_info, NULL);
       }
 
       if (mem_op_type == Core::WRITE)
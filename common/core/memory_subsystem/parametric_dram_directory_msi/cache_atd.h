@@ -6,7 +6,7 @@
 #include "cache_set.h"
 #include "core.h"
 
-#include <unordered_map>
+#include <vector>
 
 class CacheSet;
 
@@ -14,7 +14,12 @@ class ATD
 {
    private:
       CacheBase m_cache_base;
-      std::unordered_map<UInt32, CacheSet*> m_sets;
+      // Sampled sets are marked in a bitmap (one bit per cache set), so accesses to other sets cost one bit test.
+      // Their CacheSet objects are stored densely in set index order; the index of a sampled set in m_sets
+      // is the number of sampled sets below it, from m_rank plus a popcount within its bitmap word.
+      std::vector<UInt64> m_sampled;
+      std::vector<UInt32> m_rank;
+      std::vector<CacheSet*> m_sets;
       CacheSetInfo *m_set_info;
 
       UInt64 loads, stores;
@@ -22,7 +27,11 @@ class ATD
       UInt64 loads_constructive, stores_constructive;
       UInt64 loads_destructive, stores_destructive;
 
-      bool isSampledSet(UInt32 set_index);
+      bool isSampledSet(UInt32 set_index) const
+      { return (m_sampled[set_index >> 6] >> (set_index & 63)) & 1; }
+      CacheSet* getSampledSet(UInt32 set_index) const
+      { return m_sets[m_rank[set_index >> 6] + __builtin_popcountll(m_sampled[set_index >> 6] & ((UInt64(1) << (set_index & 63)) - 1))]; }
+      void setSampled(UInt32 set_index) { m_sampled[set_index >> 6] |= UInt64(1) << (set_index & 63); }
 
    public:
       ATD(String name, String configName, core_id_t core_id, UInt32 num_sets, UInt32 associativity,
@@ -30,6 +39,7 @@ class ATD
       ~ATD();
 
       void access(Core::mem_op_t mem_op_type, bool hit, IntPtr address);
+      CacheSetInfo* getSetInfo() const { return m_set_info; }
 };
 
 #endif // __CACHE_ATD_H
@@ -8,7 +8,9 @@
 #include "fault_injection.h"
 #include "hooks_manager.h"
 #include "cache_atd.h"
+#include "cache_partitioner.h"
 #include "shmem_perf.h"
+#include "host_profiler.h"
 
 #include <cstring>
 
@@ -65,10 +67,52 @@ const char * ReasonString(Transition::reason_t reason) {
    }
 }
 
-MshrEntry make_mshr(SubsecondTime t_issue, SubsecondTime t_complete) {
-   MshrEntry e;
-   e.t_issue = t_issue; e.t_complete = t_complete;
-   return e;
+const MshrEntry*
+Mshr::find(IntPtr address) const
+{
+   for(UInt32 idx = 0; idx < m_size; ++idx)
+      if (m_address[idx] == address)
+         return &m_entry[idx];
+   return NULL;
+}
+
+void
+Mshr::insert(IntPtr address, SubsecondTime t_issue, SubsecondTime t_complete)
+{
+   UInt32 idx;
+   for(idx = 0; idx < m_size; ++idx)
+      if (m_address[idx] == address)
+         break;
+
+   if (idx == m_size)
+   {
+      if (m_size < NUM_ENTRIES)
+         ++m_size;
+      else
+      {
+         /* Full: retire the entry with the smallest completion time, which may be the new one */
+         idx = 0;
+         for(UInt32 i = 1; i < m_size; ++i)
+            if (m_entry[i].t_complete < m_entry[idx].t_complete)
+               idx = i;
+         if (t_complete < m_entry[idx].t_complete)
+            return;
+      }
+   }
+
+   m_address[idx] = address;
+   m_entry[idx].t_issue = t_issue;
+   m_entry[idx].t_complete = t_complete;
+}
+
+SubsecondTime
+Mshr::getRemaining(IntPtr address, SubsecondTime t_now) const
+{
+   const MshrEntry* entry = find(address);
+   if (entry && entry->t_issue < t_now && entry->t_complete > t_now)
+      return entry->t_complete - t_now;
+   else
+      return SubsecondTime::Zero();
 }
 
 #ifdef ENABLE_TRACK_SHARING_PREVCACHES
@@ -85,7 +129,7 @@ void CacheMasterCntlr::createSetLocks(UInt32 cache_block_size, UInt32 num_sets,
 {
    m_log_blocksize = floorLog2(cache_block_size);
    m_num_sets = num_sets;
-   m_setlocks.resize(m_num_sets, SetLock(core_offset, num_cores));
+   m_setlocks.resize(m_num_sets, SetLock(core_offset, num_cores, &m_setlock_stats));
 }
 
 SetLock*
@@ -115,6 +159,8 @@ CacheMasterCntlr::accessATDs(Core::mem_op_t mem_op_type, bool hit, IntPtr addres
 CacheMasterCntlr::~CacheMasterCntlr()
 {
    delete m_cache;
+   if (m_partitioner)
+      delete m_partitioner;
    for(std::vector<ATD*>::iterator it = m_atds.begin(); it != m_atds.end(); ++it)
    {
       delete *it;
@@ -194,6 +240,17 @@ CacheCntlr::CacheCntlr(MemComponent::component_t mem_component,
                CacheBase::parseAddressHash(cache_params.hash_function));
       }
 
+      if (Sim()->getCfg()->getBoolDefault("perf_model/" + cache_params.configName + "/partitioning/enabled", false))
+      {
+         m_master->m_partitioner = new CachePartitioner(name,
+               "perf_model/" + cache_params.configName,
+               m_core_id,
+               m_shared_cores,
+               cache_params.associativity,
+               CacheSet::parsePolicyType(cache_params.replacement_policy),
+               m_master->m_atds);
+      }
+
       Sim()->getHooksManager()->registerHook(HookType::HOOK_ROI_END, __walkUsageBits, (UInt64)this, HooksManager::ORDER_NOTIFY_PRE);
    }
    else
@@ -322,6 +379,7 @@ CacheCntlr::processMemOpFromCore(
       bool modeled,
       bool count)
 {
+   HostProfiler::Scoped hp(HostProfiler::MEMORY);
    HitWhere::where_t hit_where = HitWhere::MISS;
 
    // Protect against concurrent access from sibling SMT threads
@@ -427,10 +485,9 @@ MYLOG("L1 hit");
          ScopedLock sl(getLock());
          // This is a hit, but maybe the prefetcher filled it at a future time stamp. If so, delay.
          SubsecondTime t_now = getShmemPerfModel()->getElapsedTime(ShmemPerfModel::_USER_THREAD);
-         if (m_master->mshr.count(ca_address)
-            && (m_master->mshr[ca_address].t_issue < t_now && m_master->mshr[ca_address].t_complete > t_now))
+         SubsecondTime latency = m_master->mshr.getRemaining(ca_address, t_now);
+         if (latency > SubsecondTime::Zero())
          {
-            SubsecondTime latency = m_master->mshr[ca_address].t_complete - t_now;
             stats.mshr_latency += latency;
             getMemoryManager()->incrElapsedTime(latency, ShmemPerfModel::_USER_THREAD);
          }
@@ -823,10 +880,9 @@ CacheCntlr::processShmemReqFromPrevCache(CacheCntlr* requester, Core::mem_op_t m
          ScopedLock sl(getLock());
          // This is a hit, but maybe the prefetcher filled it at a future time stamp. If so, delay.
          SubsecondTime t_now = getShmemPerfModel()->getElapsedTime(ShmemPerfModel::_USER_THREAD);
-         if (m_master->mshr.count(address)
-            && (m_master->mshr[address].t_issue < t_now && m_master->mshr[address].t_complete > t_now))
+         SubsecondTime latency = m_master->mshr.getRemaining(address, t_now);
+         if (latency > SubsecondTime::Zero())
          {
-            SubsecondTime latency = m_master->mshr[address].t_complete - t_now;
             stats.mshr_latency += latency;
             getMemoryManager()->incrElapsedTime(latency, ShmemPerfModel::_USER_THREAD);
          }
@@ -1003,8 +1059,7 @@ CacheCntlr::processShmemReqFromPrevCache(CacheCntlr* requester, Core::mem_op_t m
       if (modeled && !first_hit && !m_passthrough)
       {
          ScopedLock sl(getLock());
-         m_master->mshr[address] = make_mshr(t_issue, getShmemPerfModel()->getElapsedTime(ShmemPerfModel::_USER_THREAD));
-         cleanupMshr();
+         m_master->mshr.insert(address, t_issue, getShmemPerfModel()->getElapsedTime(ShmemPerfModel::_USER_THREAD));
       }
    }
 
@@ -1371,7 +1426,8 @@ MYLOG("insertCacheBlock l%d @ %lx as %c (now %c)", m_mem_component, address, CSt
 
    m_master->m_cache->insertSingleLine(address, data_buf,
          &eviction, &evict_address, &evict_block_info, evict_buf,
-         getShmemPerfModel()->getElapsedTime(thread_num), this);
+         getShmemPerfModel()->getElapsedTime(thread_num), this,
+         m_master->m_partitioner ? m_master->m_partitioner->getWayMask(m_core_id - m_core_id_master) : CacheSet::ALL_WAYS);
    SharedCacheBlockInfo* cache_block_info = setCacheState(address, cstate);
 
    if (Sim()->getInstrumentationMode() == InstMode::CACHE_ONLY)
@@ -1704,7 +1760,7 @@ MYLOG(" ");
       MYLOG("writing to evict buffer %lx", address);
 assert(offset==0);
 assert(data_length==getCacheBlockSize());
-      if (data_buf)
+      if (data_buf && !CacheBase::isTagOnly())
          memcpy(m_master->m_evicting_buf + offset, data_buf, data_length);
    } else {
       __attribute__((unused)) SharedCacheBlockInfo* cache_block_info = (SharedCacheBlockInfo*) m_master->m_cache->accessSingleLine(
@@ -1844,8 +1900,7 @@ MYLOG("wakeup user #%u", request->cache_cntlr->m_core_id);
 
          {
             ScopedLock sl(request->cache_cntlr->getLock());
-            request->cache_cntlr->m_master->mshr[address] = make_mshr(request->t_issue, getShmemPerfModel()->getElapsedTime(ShmemPerfModel::_SIM_THREAD));
-            cleanupMshr();
+            request->cache_cntlr->m_master->mshr.insert(address, request->t_issue, getShmemPerfModel()->getElapsedTime(ShmemPerfModel::_SIM_THREAD));
          }
 
          getLock().acquire();
@@ -2052,7 +2107,7 @@ CacheCntlr::updateCounters(Core::mem_op_t mem_op_type, IntPtr address, bool cach
       operationPermissibleinCache() will think it's a hit (so cache_hit == true) since the processing
       of the previous miss was done instantaneously. But mshr[address] contains its completion time */
    SubsecondTime t_now = getShmemPerfModel()->getElapsedTime(ShmemPerfModel::_USER_THREAD);
-   bool overlapping = m_master->mshr.count(address) && m_master->mshr[address].t_issue < t_now && m_master->mshr[address].t_complete > t_now;
+   bool overlapping = m_master->mshr.getRemaining(address, t_now) > SubsecondTime::Zero();
 
    // ATD doesn't track state, so when reporting hit/miss to it we shouldn't either (i.e. write hit to shared line becomes hit, not miss)
    bool cache_data_hit = (state != CacheState::INVALID);
@@ -2089,8 +2144,6 @@ CacheCntlr::updateCounters(Core::mem_op_t mem_op_type, IntPtr address, bool cach
       }
    }
 
-   cleanupMshr();
-
    #ifdef ENABLE_TRANSITIONS
    transition(
       address,
@@ -2101,23 +2154,6 @@ CacheCntlr::updateCounters(Core::mem_op_t mem_op_type, IntPtr address, bool cach
    #endif
 }
 
-void
-CacheCntlr::cleanupMshr()
-{
-   /* Keep only last 8 MSHR entries */
-   while(m_master->mshr.size() > 8) {
-      IntPtr address_min = 0;
-      SubsecondTime time_min = SubsecondTime::MaxTime();
-      for(Mshr::iterator it = m_master->mshr.begin(); it != m_master->mshr.end(); ++it) {
-         if (it->second.t_complete < time_min) {
-            address_min = it->first;
-            time_min = it->second.t_complete;
-         }
-      }
-      m_master->mshr.erase(address_min);
-   }
-}
-
 void
 CacheCntlr::transition(IntPtr address, Transition::reason_t reason, CacheState::cstate_t old_state, CacheState::cstate_t new_state)
 {
@@ -2182,6 +2218,16 @@ CacheCntlr::updateUncoreStatistics(HitWhere::where_t hit_where, SubsecondTime no
    use getLock() for this. This is required for statistics updates, the directory waiters queue, etc.
 */
 
+void
+CacheCntlr::createSetLocks(UInt32 cache_block_size, UInt32 num_sets, UInt32 core_offset, UInt32 num_cores)
+{
+   m_master->createSetLocks(cache_block_size, num_sets, core_offset, num_cores);
+
+   registerStatsMetric(getCache()->getName(), m_core_id, "setlock-contended-shared", &m_master->m_setlock_stats.shared_contended);
+   registerStatsMetric(getCache()->getName(), m_core_id, "setlock-contended-exclusive", &m_master->m_setlock_stats.exclusive_contended);
+   registerStatsMetric(getCache()->getName(), m_core_id, "setlock-wait-time", &m_master->m_setlock_stats.wait_time);
+}
+
 void
 CacheCntlr::acquireLock(UInt64 address)
 {
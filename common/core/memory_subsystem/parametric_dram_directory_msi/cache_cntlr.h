@@ -21,6 +21,7 @@
 
 class DramCntlrInterface;
 class ATD;
+class CachePartitioner;
 
 /* Enable to get a detailed count of state transitions */
 //#define ENABLE_TRANSITIONS
@@ -143,7 +144,27 @@ namespace ParametricDramDirectoryMSI
    struct MshrEntry {
       SubsecondTime t_issue, t_complete;
    };
-   typedef std::unordered_map<IntPtr, MshrEntry> Mshr;
+
+   // Issue and completion times of the last few misses, so accesses to a line that is still
+   // being fetched see the remaining latency. When full, the entry that completes first is retired.
+   // Fixed size and stored inline: lookups and retirement scan a handful of contiguous entries.
+   class Mshr
+   {
+      public:
+         static const UInt32 NUM_ENTRIES = 8;
+
+         Mshr() : m_size(0) {}
+
+         const MshrEntry* find(IntPtr address) const;
+         void insert(IntPtr address, SubsecondTime t_issue, SubsecondTime t_complete);
+         // Remaining latency if a miss to address is in flight at t_now, zero otherwise
+         SubsecondTime getRemaining(IntPtr address, SubsecondTime t_now) const;
+
+      private:
+         IntPtr m_address[NUM_ENTRIES];
+         MshrEntry m_entry[NUM_ENTRIES];
+         UInt32 m_size;
+   };
 
    class CacheMasterCntlr
    {
@@ -164,8 +185,10 @@ namespace ParametricDramDirectoryMSI
          Byte* m_evicting_buf;
 
          std::vector<ATD*> m_atds;
+         CachePartitioner* m_partitioner;
 
          std::vector<SetLock> m_setlocks;
+         SetLockStats m_setlock_stats;
          UInt32 m_log_blocksize;
          UInt32 m_num_sets;
 
@@ -189,6 +212,7 @@ namespace ParametricDramDirectoryMSI
             , m_evicting_address(0)
             , m_evicting_buf(NULL)
             , m_atds()
+            , m_partitioner(NULL)
             , m_prefetch_list()
             , m_prefetch_next(SubsecondTime::Zero())
          {}
@@ -249,7 +273,6 @@ namespace ParametricDramDirectoryMSI
          #endif
 
          void updateCounters(Core::mem_op_t mem_op_type, IntPtr address, bool cache_hit, CacheState::cstate_t state, Prefetch::prefetch_type_t isPrefetch);
-         void cleanupMshr();
          void transition(IntPtr address, Transition::reason_t reason, CacheState::cstate_t old_state, CacheState::cstate_t new_state);
          void updateUncoreStatistics(HitWhere::where_t hit_where, SubsecondTime now);
 
@@ -367,7 +390,7 @@ namespace ParametricDramDirectoryMSI
 
          void setPrevCacheCntlrs(CacheCntlrList& prev_cache_cntlrs);
          void setNextCacheCntlr(CacheCntlr* next_cache_cntlr) { m_next_cache_cntlr = next_cache_cntlr; }
-         void createSetLocks(UInt32 cache_block_size, UInt32 num_sets, UInt32 core_offset, UInt32 num_cores) { m_master->createSetLocks(cache_block_size, num_sets, core_offset, num_cores); }
+         void createSetLocks(UInt32 cache_block_size, UInt32 num_sets, UInt32 core_offset, UInt32 num_cores);
          void setDRAMDirectAccess(DramCntlrInterface* dram_cntlr, UInt64 num_outstanding);
 
          HitWhere::where_t processMemOpFromCore(
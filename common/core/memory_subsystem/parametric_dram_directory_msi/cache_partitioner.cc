@@ -0,0 +1,164 @@
+#include "cache_partitioner.h"
+#include "cache_atd.h"
+#include "cache_set.h"
+#include "cache_set_lru.h"
+#include "simulator.h"
+#include "config.hpp"
+#include "hooks_manager.h"
+#include "stats.h"
+#include "log.h"
+
+CachePartitioner::CachePartitioner(String name, String configName, core_id_t core_id_master, UInt32 shared_cores,
+      UInt32 associativity, CacheBase::ReplacementPolicy replacement_policy, const std::vector<ATD*> &atds)
+   : m_shared_cores(shared_cores)
+   , m_associativity(associativity)
+   , m_atds(atds)
+   , m_ways(shared_cores, 0)
+   , m_way_mask(shared_cores, 0)
+   , m_hits_prev(shared_cores, std::vector<UInt64>(associativity, 0))
+   , m_epoch(SubsecondTime::Zero())
+   , m_next_epoch(SubsecondTime::MaxTime())
+   , m_repartitions(0)
+{
+   LOG_ASSERT_ERROR(CacheSet::supportsPartitioning(replacement_policy), "Replacement policy of %s does not support way partitioning", name.c_str());
+   LOG_ASSERT_ERROR(associativity <= 64, "Way partitioning supports at most 64 ways, %s has %d", name.c_str(), associativity);
+   LOG_ASSERT_ERROR(shared_cores <= associativity, "Cannot partition %d ways of %s among %d cores", associativity, name.c_str(), shared_cores);
+
+   std::vector<UInt32> ways(shared_cores);
+
+   String type = Sim()->getCfg()->getString(configName + "/partitioning/type");
+   if (type == "static")
+   {
+      // Ways that are not assigned to any core are never allocated into
+      UInt32 total = 0;
+      for(UInt32 core_num = 0; core_num < shared_cores; ++core_num)
+      {
+         ways[core_num] = Sim()->getCfg()->getIntArray(configName + "/partitioning/ways", core_id_master + core_num);
+         LOG_ASSERT_ERROR(ways[core_num] > 0, "Core %d needs at least one way of %s", core_id_master + core_num, name.c_str());
+         total += ways[core_num];
+      }
+      LOG_ASSERT_ERROR(total <= associativity, "Partitions of %s use %d ways, but it only has %d", name.c_str(), total, associativity);
+   }
+   else if (type == "ucp")
+   {
+      LOG_ASSERT_ERROR(atds.size() == shared_cores, "UCP partitioning of %s requires ATDs (atd/enabled = true)", name.c_str());
+      // Not lru_qbs: the ATDs have no lower-level caches to query, their QBS sets would have no controller to ask
+      LOG_ASSERT_ERROR(replacement_policy == CacheBase::LRU,
+         "UCP partitioning of %s requires LRU replacement, to obtain hit counts per stack position", name.c_str());
+
+      m_epoch = SubsecondTime::NS(Sim()->getCfg()->getInt(configName + "/partitioning/ucp/epoch"));
+      LOG_ASSERT_ERROR(m_epoch > SubsecondTime::Zero(), "%s/partitioning/ucp/epoch must be larger than zero", configName.c_str());
+      m_next_epoch = m_epoch;
+
+      // Start with an even split, the remainder goes to the first cores
+      for(UInt32 core_num = 0; core_num < shared_cores; ++core_num)
+         ways[core_num] = associativity / shared_cores + (core_num < associativity % shared_cores ? 1 : 0);
+
+      // Repartition before schedulers and scripts (ORDER_ACTION and later) look at the masks
+      Sim()->getHooksManager()->registerHook(HookType::HOOK_PERIODIC, CachePartitioner::hookPeriodic, (UInt64)this, HooksManager::ORDER_NOTIFY_PRE);
+   }
+   else
+   {
+      LOG_PRINT_ERROR("Invalid cache partitioning type %s for %s", type.c_str(), name.c_str());
+   }
+
+   setPartition(ways);
+
+   for(UInt32 core_num = 0; core_num < shared_cores; ++core_num)
+   {
+      registerStatsMetric(name, core_id_master + core_num, "partition-ways", &m_ways[core_num]);
+      registerStatsMetric(name, core_id_master + core_num, "partition-mask", &m_way_mask[core_num]);
+   }
+   registerStatsMetric(name, core_id_master, "partition-repartitions", &m_repartitions);
+}
+
+void
+CachePartitioner::setPartition(const std::vector<UInt32> &ways)
+{
+   // Give each core a contiguous range of ways, in core order.
+   // Cores read their mask without locking while it is updated here; this is harmless as a mask is
+   // a single word, and a line inserted under the previous partition is simply evicted later.
+   UInt32 first = 0;
+   for(UInt32 core_num = 0; core_num < m_shared_cores; ++core_num)
+   {
+      m_ways[core_num] = ways[core_num];
+      m_way_mask[core_num] = (ways[core_num] == 64 ? ~UInt64(0) : (UInt64(1) << ways[core_num]) - 1) << first;
+      first += ways[core_num];
+   }
+}
+
+void
+CachePartitioner::repartition(SubsecondTime time)
+{
+   if (time < m_next_epoch)
+      return;
+   while (m_next_epoch <= time)
+      m_next_epoch += m_epoch;
+
+   // Hits per LRU stack position in each core's ATD, during the epoch that just ended
+   std::vector<std::vector<UInt64> > hits(m_shared_cores, std::vector<UInt64>(m_associativity, 0));
+   UInt64 total_hits = 0;
+   for(UInt32 core_num = 0; core_num < m_shared_cores; ++core_num)
+   {
+      CacheSetInfoLRU *set_info = static_cast<CacheSetInfoLRU*>(m_atds[core_num]->getSetInfo());
+      for(UInt32 position = 0; position < m_associativity; ++position)
+      {
+         UInt64 accesses = set_info->getAccesses(position);
+         hits[core_num][position] = accesses - m_hits_prev[core_num][position];
+         m_hits_prev[core_num][position] = accesses;
+         total_hits += hits[core_num][position];
+      }
+   }
+
+   // Without any hits (idle cores, warm-up) there is no utility information: keep the current partition
+   if (total_hits == 0)
+      return;
+
+   std::vector<UInt32> ways = lookahead(hits);
+   for(UInt32 core_num = 0; core_num < m_shared_cores; ++core_num)
+   {
+      if (ways[core_num] != m_ways[core_num])
+      {
+         ++m_repartitions;
+         setPartition(ways);
+         break;
+      }
+   }
+}
+
+std::vector<UInt32>
+CachePartitioner::lookahead(const std::vector<std::vector<UInt64> > &hits) const
+{
+   // Lookahead allocation: every core gets one way, then the remaining ways are handed out in steps,
+   // each time to the core with the highest marginal utility (extra hits per extra way) over any number of ways.
+   // This finds good allocations even when a core's utility curve is not convex.
+   std::vector<UInt32> ways(m_shared_cores, 1);
+   UInt32 balance = m_associativity - m_shared_cores;
+
+   while (balance)
+   {
+      UInt32 winner = 0, winner_ways = 1;
+      double winner_utility = -1;
+
+      for(UInt32 core_num = 0; core_num < m_shared_cores; ++core_num)
+      {
+         UInt64 gain = 0;
+         for(UInt32 extra = 1; extra <= balance; ++extra)
+         {
+            gain += hits[core_num][ways[core_num] + extra - 1];
+            double utility = double(gain) / extra;
+            if (utility > winner_utility)
+            {
+               winner = core_num;
+               winner_ways = extra;
+               winner_utility = utility;
+            }
+         }
+      }
+
+      ways[winner] += winner_ways;
+      balance -= winner_ways;
+   }
+
+   return ways;
+}
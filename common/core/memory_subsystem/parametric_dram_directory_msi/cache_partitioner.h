@@ -0,0 +1,47 @@
+#ifndef __CACHE_PARTITIONER_H
+#define __CACHE_PARTITIONER_H
+
+#include "fixed_types.h"
+#include "cache_base.h"
+#include "subsecond_time.h"
+
+#include <vector>
+
+class ATD;
+
+// Way partitioning of a shared cache among its sharing cores. Each core may only allocate (replace) lines
+// in its own, contiguous range of ways; hits are not restricted. Partitions are either fixed from the
+// configuration (static), or recomputed every epoch from the per-core ATDs using
+// Utility-based Cache Partitioning [Qureshi and Patt, MICRO'06] (ucp).
+// The current masks are exported as statistics, so schedulers and scripts can read them at any time.
+class CachePartitioner
+{
+   public:
+      CachePartitioner(String name, String configName, core_id_t core_id_master, UInt32 shared_cores,
+         UInt32 associativity, CacheBase::ReplacementPolicy replacement_policy, const std::vector<ATD*> &atds);
+
+      // Ways the given sharing core (0 .. shared_cores-1) may replace
+      UInt64 getWayMask(UInt32 core_num) const { return m_way_mask[core_num]; }
+
+   private:
+      const UInt32 m_shared_cores;
+      const UInt32 m_associativity;
+      const std::vector<ATD*> &m_atds;
+
+      std::vector<UInt64> m_ways;
+      std::vector<UInt64> m_way_mask;
+      // Per-core ATD hit counts by stack position at the start of the current epoch
+      std::vector<std::vector<UInt64> > m_hits_prev;
+      SubsecondTime m_epoch;
+      SubsecondTime m_next_epoch;
+      UInt64 m_repartitions;
+
+      void setPartition(const std::vector<UInt32> &ways);
+      void repartition(SubsecondTime time);
+      std::vector<UInt32> lookahead(const std::vector<std::vector<UInt64> > &hits) const;
+
+      static SInt64 hookPeriodic(UInt64 object, UInt64 time)
+      { ((CachePartitioner*)object)->repartition(*(subsecond_time_t*)&time); return 0; }
+};
+
+#endif // __CACHE_PARTITIONER_H
@@ -526,11 +526,7 @@ MYLOG("begin");
    // First delete 'data_buf' if it is present
    // LOG_PRINT("Finished handling Shmem Msg");
 
-   if (shmem_msg->getDataLength() > 0)
-   {
-      assert(shmem_msg->getDataBuf());
-      delete [] shmem_msg->getDataBuf();
-   }
+   PrL1PrL2DramDirectoryMSI::ShmemMsg::releaseDataBuf(shmem_msg);
    delete shmem_msg;
 MYLOG("end");
 }
@@ -543,7 +539,9 @@ MYLOG("send msg %u %ul%u > %ul%u", msg_type, requester, sender_mem_component, re
    PrL1PrL2DramDirectoryMSI::ShmemMsg shmem_msg(msg_type, sender_mem_component, receiver_mem_component, requester, address, data_buf, data_length, perf);
    shmem_msg.setWhere(where);
 
-   Byte* msg_buf = shmem_msg.makeMsgBuf();
+   // Build the message directly in a packet buffer, so the network can pass it on without copying
+   Byte* msg_buf = NetPacket::allocData(shmem_msg.getMsgLen());
+   shmem_msg.makeMsgBuf(msg_buf);
    SubsecondTime msg_time = getShmemPerfModel()->getElapsedTime(thread_num);
    perf->updateTime(msg_time);
 
@@ -555,10 +553,10 @@ MYLOG("send msg %u %ul%u > %ul%u", msg_type, requester, sender_mem_component, re
    NetPacket packet(msg_time, SHARED_MEM_1,
          m_core_id_master, receiver,
          shmem_msg.getMsgLen(), (const void*) msg_buf);
-   getNetwork()->netSend(packet);
+   getNetwork()->netSend(packet, true /* pooled */);
 
-   // Delete the Msg Buf
-   delete [] msg_buf;
+   // Release our reference to the Msg Buf
+   NetPacket::releaseData(msg_buf);
 }
 
 void
@@ -568,7 +566,9 @@ MYLOG("bcast msg");
    assert((data_buf == NULL) == (data_length == 0));
    PrL1PrL2DramDirectoryMSI::ShmemMsg shmem_msg(msg_type, sender_mem_component, receiver_mem_component, requester, address, data_buf, data_length, perf);
 
-   Byte* msg_buf = shmem_msg.makeMsgBuf();
+   // Build the message directly in a packet buffer, so the network can pass it on without copying
+   Byte* msg_buf = NetPacket::allocData(shmem_msg.getMsgLen());
+   shmem_msg.makeMsgBuf(msg_buf);
    SubsecondTime msg_time = getShmemPerfModel()->getElapsedTime(thread_num);
    perf->updateTime(msg_time);
 
@@ -580,10 +580,10 @@ MYLOG("bcast msg");
    NetPacket packet(msg_time, SHARED_MEM_1,
          m_core_id_master, NetPacket::BROADCAST,
          shmem_msg.getMsgLen(), (const void*) msg_buf);
-   getNetwork()->netSend(packet);
+   getNetwork()->netSend(packet, true /* pooled */);
 
-   // Delete the Msg Buf
-   delete [] msg_buf;
+   // Release our reference to the Msg Buf
+   NetPacket::releaseData(msg_buf);
 }
 
 void
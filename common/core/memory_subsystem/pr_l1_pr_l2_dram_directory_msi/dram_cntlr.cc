@@ -5,6 +5,7 @@
 #include "subsecond_time.h"
 #include "stats.h"
 #include "fault_injection.h"
+#include "cache_base.h"
 
 #if 0
    extern Lock iolock;
@@ -51,7 +52,7 @@ DramCntlr::~DramCntlr()
 boost::tuple<SubsecondTime, HitWhere::where_t>
 DramCntlr::getDataFromDram(IntPtr address, core_id_t requester, Byte* data_buf, SubsecondTime now, ShmemPerf *perf)
 {
-   if (Sim()->getFaultinjectionManager())
+   if (!CacheBase::isTagOnly())
    {
       if (m_data_map.count(address) == 0)
       {
@@ -80,7 +81,7 @@ DramCntlr::getDataFromDram(IntPtr address, core_id_t requester, Byte* data_buf,
 boost::tuple<SubsecondTime, HitWhere::where_t>
 DramCntlr::putDataToDram(IntPtr address, core_id_t requester, Byte* data_buf, SubsecondTime now)
 {
-   if (Sim()->getFaultinjectionManager())
+   if (!CacheBase::isTagOnly())
    {
       if (m_data_map[address] == NULL)
       {
@@ -1,9 +1,16 @@
 #include <string.h>
+#include <cassert>
 #include "shmem_msg.h"
 #include "log.h"
+#include "cache_base.h"
 
 namespace PrL1PrL2DramDirectoryMSI
 {
+   // In tag-only mode, messages carry the data length (for timing) but not the data itself.
+   // Receivers get this buffer instead, so code testing getDataBuf() for NULL still sees a payload.
+   // It is shared by all receiving threads and const (so it lives in read-only memory): writing into it faults.
+   static const Byte s_no_data[4096] = { 0 };
+
    ShmemMsg::ShmemMsg() :
       m_msg_type(INVALID_MSG_TYPE),
       m_sender_mem_component(MemComponent::INVALID_MEM_COMPONENT),
@@ -49,12 +56,27 @@ namespace PrL1PrL2DramDirectoryMSI
    ShmemMsg::~ShmemMsg()
    {}
 
+   void
+   ShmemMsg::releaseDataBuf(ShmemMsg* shmem_msg)
+   {
+      if (shmem_msg->getDataLength() > 0 && !CacheBase::isTagOnly())
+      {
+         assert(shmem_msg->getDataBuf());
+         delete [] shmem_msg->getDataBuf();
+      }
+   }
+
    ShmemMsg*
    ShmemMsg::getShmemMsg(Byte* msg_buf)
    {
       ShmemMsg* shmem_msg = new ShmemMsg();
       memcpy((void*) shmem_msg, msg_buf, sizeof(*shmem_msg));
-      if (shmem_msg->getDataLength() > 0)
+      if (shmem_msg->getDataLength() > 0 && CacheBase::isTagOnly())
+      {
+         LOG_ASSERT_ERROR(shmem_msg->getDataLength() <= sizeof(s_no_data), "Data length %u too large", shmem_msg->getDataLength());
+         shmem_msg->setDataBuf(const_cast<Byte*>(s_no_data));
+      }
+      else if (shmem_msg->getDataLength() > 0)
       {
          shmem_msg->setDataBuf(new Byte[shmem_msg->getDataLength()]);
          memcpy((void*) shmem_msg->getDataBuf(), msg_buf + sizeof(*shmem_msg), shmem_msg->getDataLength());
@@ -66,20 +88,26 @@ namespace PrL1PrL2DramDirectoryMSI
    ShmemMsg::makeMsgBuf()
    {
       Byte* msg_buf = new Byte[getMsgLen()];
+      makeMsgBuf(msg_buf);
+      return msg_buf;
+   }
+
+   void
+   ShmemMsg::makeMsgBuf(Byte* msg_buf)
+   {
       memcpy(msg_buf, (void*) this, sizeof(*this));
-      if (m_data_length > 0)
+      if (m_data_length > 0 && !CacheBase::isTagOnly())
       {
          LOG_ASSERT_ERROR(m_data_buf != NULL, "m_data_buf(%p)", m_data_buf);
          memcpy(msg_buf + sizeof(*this), (void*) m_data_buf, m_data_length);
       }
-
-      return msg_buf;
    }
 
    UInt32
    ShmemMsg::getMsgLen()
    {
-      return (sizeof(*this) + m_data_length);
+      // The modeled length (getModeledLength) always includes the data, even if it is not transferred
+      return (sizeof(*this) + (CacheBase::isTagOnly() ? 0 : m_data_length));
    }
 
    UInt32
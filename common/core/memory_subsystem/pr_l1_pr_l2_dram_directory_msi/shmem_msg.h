@@ -66,7 +66,9 @@ namespace PrL1PrL2DramDirectoryMSI
          ~ShmemMsg();
 
          static ShmemMsg* getShmemMsg(Byte* msg_buf);
+         static void releaseDataBuf(ShmemMsg* shmem_msg);
          Byte* makeMsgBuf();
+         void makeMsgBuf(Byte* msg_buf);
          UInt32 getMsgLen();
 
          // Modeling
@@ -0,0 +1,48 @@
+#include "contention_lock.h"
+#include "timer.h"
+#include "stats.h"
+
+ContentionLock::ContentionLock()
+   : m_acquires(0)
+   , m_contended(0)
+   , m_wait_time(0)
+   , m_lock(LockCreator_Default::create())
+{
+}
+
+ContentionLock::~ContentionLock()
+{
+   delete m_lock;
+}
+
+void ContentionLock::acquire()
+{
+   if (!m_lock->try_acquire())
+   {
+      UInt64 t_start = Timer::now();
+      m_lock->acquire();
+      ++m_contended;
+      m_wait_time += Timer::now() - t_start;
+   }
+   ++m_acquires;
+}
+
+void ContentionLock::release()
+{
+   m_lock->release();
+}
+
+bool ContentionLock::try_acquire()
+{
+   if (!m_lock->try_acquire())
+      return false;
+   ++m_acquires;
+   return true;
+}
+
+void ContentionLock::registerStats(String objectName)
+{
+   registerStatsMetric(objectName, 0, "lock_acquires", &m_acquires);
+   registerStatsMetric(objectName, 0, "lock_contended", &m_contended);
+   registerStatsMetric(objectName, 0, "lock_wait_time", &m_wait_time);
+}
@@ -0,0 +1,32 @@
+#ifndef CONTENTION_LOCK_H
+#define CONTENTION_LOCK_H
+
+#include "lock.h"
+#include "fixed_types.h"
+
+// Lock implementation that counts how often it had to wait, and for how long.
+// Counters are only updated while holding the lock, so they need no atomics.
+// Use as Lock m_lock(new ContentionLock()), and register the counters as statistics.
+
+class ContentionLock : public LockImplementation
+{
+   public:
+      ContentionLock();
+      ~ContentionLock();
+
+      void acquire();
+      void release();
+      bool try_acquire();
+
+      UInt64 m_acquires;
+      UInt64 m_contended;
+      UInt64 m_wait_time;  // Host time spent waiting for the lock, in ns
+
+      // Register lock_acquires, lock_contended and lock_wait_time for <objectName>[0]
+      void registerStats(String objectName);
+
+   private:
+      LockImplementation *m_lock;
+};
+
+#endif // CONTENTION_LOCK_H
@@ -0,0 +1,200 @@
+#include "host_perf_counters.h"
+#include "simulator.h"
+#include "hooks_manager.h"
+#include "magic_server.h"
+#include "stats.h"
+#include "timer.h"
+#include "config.hpp"
+#include "log.h"
+#include "linux/perf_event.h"
+
+#include <errno.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+
+const char* HostPerfCounters::counter_names[] = {
+   "cycles",
+   "instructions",
+   "llc_misses",
+   "branch_misses",
+};
+static_assert(HostPerfCounters::NUM_COUNTERS == sizeof(HostPerfCounters::counter_names) / sizeof(HostPerfCounters::counter_names[0]),
+              "Not enough values in HostPerfCounters::counter_names");
+
+static const UInt64 counter_configs[] = {
+   PERF_COUNT_HW_CPU_CYCLES,
+   PERF_COUNT_HW_INSTRUCTIONS,
+   PERF_COUNT_HW_CACHE_MISSES,
+   PERF_COUNT_HW_BRANCH_MISSES,
+};
+
+bool HostPerfCounters::s_enabled = false;
+Lock HostPerfCounters::s_lock;
+std::vector<HostPerfCounters::ThreadCounters> HostPerfCounters::s_threads;
+UInt64 HostPerfCounters::s_totals[HostPerfCounters::NUM_COUNTERS] = { 0 };
+UInt64 HostPerfCounters::s_last[HostPerfCounters::NUM_COUNTERS] = { 0 };
+SubsecondTime HostPerfCounters::s_interval;
+SubsecondTime HostPerfCounters::s_next_sample;
+UInt64 HostPerfCounters::s_instructions_last = 0;
+UInt64 HostPerfCounters::s_host_time_last = 0;
+FILE *HostPerfCounters::s_fp = NULL;
+
+void HostPerfCounters::init()
+{
+   if (!Sim()->getCfg()->getBool("host_perf/enabled"))
+      return;
+
+   // Probe whether we are allowed to use perf_event at all
+   int fd = openCounter(PERF_COUNT_HW_CPU_CYCLES);
+   if (fd < 0)
+   {
+      LOG_PRINT_WARNING("host_perf: perf_event_open() failed (%s), host performance counters disabled", strerror(errno));
+      return;
+   }
+   close(fd);
+
+   s_interval = SubsecondTime::NS(Sim()->getCfg()->getInt("host_perf/interval"));
+   s_next_sample = s_interval;
+   s_host_time_last = Timer::now();
+
+   s_fp = fopen(Sim()->getConfig()->formatOutputFileName("sim.hostperf.out").c_str(), "w");
+   LOG_ASSERT_ERROR(s_fp, "Cannot open sim.hostperf.out");
+   // Simulated time at the end of the interval, followed by per-interval simulated instructions, host time and host counters
+   fprintf(s_fp, "# time_ns sim_instructions host_ns");
+   for(UInt32 c = 0; c < NUM_COUNTERS; ++c)
+      fprintf(s_fp, " %s", counter_names[c]);
+   fprintf(s_fp, "\n");
+
+   for(UInt64 c = 0; c < NUM_COUNTERS; ++c)
+      Sim()->getStatsManager()->registerMetric(new StatsMetricCallback("host_perf", 0, counter_names[c], getStat, c));
+
+   Sim()->getHooksManager()->registerHook(HookType::HOOK_PERIODIC, hookPeriodic, 0, HooksManager::ORDER_NOTIFY_POST);
+   Sim()->getHooksManager()->registerHook(HookType::HOOK_THREAD_START, hookThreadStart, 0);
+
+   s_enabled = true;
+}
+
+void HostPerfCounters::fini()
+{
+   if (!s_enabled)
+      return;
+
+   ScopedLock sl(s_lock);
+
+   readCounters();
+
+   // Per-thread totals
+   for(std::vector<ThreadCounters>::iterator it = s_threads.begin(); it != s_threads.end(); ++it)
+   {
+      fprintf(s_fp, "# thread %s", it->name.c_str());
+      for(UInt32 c = 0; c < NUM_COUNTERS; ++c)
+      {
+         UInt64 value = 0;
+         if (it->fd[c] >= 0)
+         {
+            if (read(it->fd[c], &value, sizeof(value)) != sizeof(value))
+               value = 0;
+            close(it->fd[c]);
+         }
+         fprintf(s_fp, " %s=%" PRIu64, counter_names[c], value);
+      }
+      fprintf(s_fp, "\n");
+   }
+   s_threads.clear();
+
+   fclose(s_fp);
+   s_fp = NULL;
+   s_enabled = false;
+}
+
+int HostPerfCounters::openCounter(UInt64 config)
+{
+#ifdef __NR_perf_event_open
+   struct perf_event_attr attr;
+   memset(&attr, 0, sizeof(attr));
+   attr.type = PERF_TYPE_HARDWARE;
+   attr.size = sizeof(attr);
+   attr.config = config;
+   attr.exclude_kernel = 1;
+   attr.exclude_hv = 1;
+   // pid = 0, cpu = -1: count the calling thread on any CPU
+   return syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0);
+#else
+   errno = ENOSYS;
+   return -1;
+#endif
+}
+
+void HostPerfCounters::registerThread(String name)
+{
+   if (!s_enabled)
+      return;
+
+   ThreadCounters counters;
+   counters.name = name;
+   // Individual counters may not be supported (e.g. in virtual machines), these are left closed and read as zero
+   for(UInt32 c = 0; c < NUM_COUNTERS; ++c)
+      counters.fd[c] = openCounter(counter_configs[c]);
+
+   ScopedLock sl(s_lock);
+   s_threads.push_back(counters);
+}
+
+void HostPerfCounters::readCounters()
+{
+   // Counters of exited threads keep their final value, so summing over all threads gives monotonic totals
+   for(UInt32 c = 0; c < NUM_COUNTERS; ++c)
+   {
+      UInt64 total = 0;
+      for(std::vector<ThreadCounters>::iterator it = s_threads.begin(); it != s_threads.end(); ++it)
+      {
+         UInt64 value;
+         if (it->fd[c] >= 0 && read(it->fd[c], &value, sizeof(value)) == sizeof(value))
+            total += value;
+      }
+      s_totals[c] = total;
+   }
+}
+
+SInt64 HostPerfCounters::hookPeriodic(UInt64, UInt64 _time)
+{
+   SubsecondTime time(*(subsecond_time_t*)&_time);
+   if (time < s_next_sample)
+      return 0;
+   s_next_sample = time + s_interval;
+
+   ScopedLock sl(s_lock);
+
+   readCounters();
+
+   UInt64 instructions = MagicServer::getGlobalInstructionCount();
+   UInt64 host_time = Timer::now();
+   fprintf(s_fp, "%" PRIu64 " %" PRIu64 " %" PRIu64, time.getNS(), instructions - s_instructions_last, host_time - s_host_time_last);
+   for(UInt32 c = 0; c < NUM_COUNTERS; ++c)
+   {
+      fprintf(s_fp, " %" PRIu64, s_totals[c] - s_last[c]);
+      s_last[c] = s_totals[c];
+   }
+   fprintf(s_fp, "\n");
+   s_instructions_last = instructions;
+   s_host_time_last = host_time;
+
+   return 0;
+}
+
+SInt64 HostPerfCounters::hookThreadStart(UInt64, UInt64 _args)
+{
+   // HOOK_THREAD_START is called from the starting thread itself
+   HooksManager::ThreadTime *args = (HooksManager::ThreadTime *)_args;
+   registerThread(String("thread-") + itostr(args->thread_id));
+   return 0;
+}
+
+UInt64 HostPerfCounters::getStat(String objectName, UInt32 index, String metricName, UInt64 arg)
+{
+   ScopedLock sl(s_lock);
+   if (s_enabled)
+      readCounters();
+   return s_totals[arg];
+}
@@ -0,0 +1,61 @@
+#ifndef HOST_PERF_COUNTERS_H
+#define HOST_PERF_COUNTERS_H
+
+#include "fixed_types.h"
+#include "subsecond_time.h"
+#include "lock.h"
+
+#include <vector>
+
+// Host hardware performance counters (perf_event) for the simulator's own threads.
+//
+// Counters are opened per host thread when it registers (application threads at HOOK_THREAD_START, simulator
+// threads at startup), and are read at every HOOK_PERIODIC (barrier). Each sampling interval, the counter deltas
+// summed over all threads are written to sim.hostperf.out next to simulated time and instruction count.
+// When perf_event_open() is not available or not permitted (see /proc/sys/kernel/perf_event_paranoid),
+// a warning is printed and sampling is disabled; counters that are not supported by the host read as zero.
+//
+// Enable with host_perf/enabled = true.
+class HostPerfCounters
+{
+   public:
+      enum counter_t {
+         CYCLES = 0,
+         INSTRUCTIONS,
+         LLC_MISSES,
+         BRANCH_MISSES,
+         NUM_COUNTERS
+      };
+      static const char* counter_names[];
+
+      static void init();
+      static void fini();
+      // Open counters for the calling thread
+      static void registerThread(String name);
+
+   private:
+      struct ThreadCounters
+      {
+         String name;
+         int fd[NUM_COUNTERS];
+      };
+
+      static bool s_enabled;
+      static Lock s_lock;
+      static std::vector<ThreadCounters> s_threads;
+      static UInt64 s_totals[NUM_COUNTERS];      // Totals over all threads at the last sample
+      static UInt64 s_last[NUM_COUNTERS];        // Totals at the start of the current interval
+      static SubsecondTime s_interval;
+      static SubsecondTime s_next_sample;
+      static UInt64 s_instructions_last;
+      static UInt64 s_host_time_last;
+      static FILE *s_fp;
+
+      static int openCounter(UInt64 config);
+      static void readCounters();
+      static SInt64 hookPeriodic(UInt64, UInt64 time);
+      static SInt64 hookThreadStart(UInt64, UInt64 args);
+      static UInt64 getStat(String objectName, UInt32 index, String metricName, UInt64 arg);
+};
+
+#endif // HOST_PERF_COUNTERS_H
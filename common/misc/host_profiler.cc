@@ -0,0 +1,198 @@
+#include "host_profiler.h"
+#include "simulator.h"
+#include "core_manager.h"
+#include "core.h"
+#include "stats.h"
+#include "timer.h"
+#include "config.hpp"
+
+#include <stdlib.h>
+#include <string.h>
+
+const char* HostProfiler::component_names[] = {
+   "other",
+   "core_model",
+   "memory",
+   "queue_model",
+   "barrier",
+   "hooks",
+   "stats",
+};
+static_assert(HostProfiler::NUM_COMPONENTS == sizeof(HostProfiler::component_names) / sizeof(HostProfiler::component_names[0]),
+              "Not enough values in HostProfiler::component_names");
+
+bool HostProfiler::s_enabled = false;
+UInt32 HostProfiler::s_num_cores = 0;
+HostProfiler::Totals *HostProfiler::s_totals = NULL;
+Lock HostProfiler::s_slots_lock;
+std::vector<HostProfiler::Slot*> HostProfiler::s_slots;
+UInt64 HostProfiler::s_rdtsc_start = 0;
+UInt64 HostProfiler::s_time_start = 0;
+
+// Metric IDs passed as StatsMetricCallback argument
+static const UInt64 METRIC_ELAPSED = HostProfiler::NUM_COMPONENTS;
+static const UInt64 METRIC_KIPS = HostProfiler::NUM_COMPONENTS + 1;
+
+void HostProfiler::init()
+{
+   if (!Sim()->getCfg()->getBool("host_profile/enabled"))
+      return;
+
+   s_num_cores = Sim()->getConfig()->getApplicationCores();
+   s_totals = (Totals*)aligned_alloc(sizeof(Totals), (s_num_cores + 1) * sizeof(Totals));
+   memset(s_totals, 0, (s_num_cores + 1) * sizeof(Totals));
+
+   s_time_start = Timer::now();
+   s_rdtsc_start = rdtsc();
+
+   for(UInt32 i = 0; i <= s_num_cores; ++i)
+   {
+      String objectName = i == s_num_cores ? "host_global" : "host";
+      UInt32 index = i == s_num_cores ? 0 : i;
+      for(UInt64 c = 0; c < NUM_COMPONENTS; ++c)
+         Sim()->getStatsManager()->registerMetric(new StatsMetricCallback(objectName, index, String(component_names[c]) + "_ns", getStat, (UInt64(i) << 8) | c));
+      if (i < s_num_cores)
+         Sim()->getStatsManager()->registerMetric(new StatsMetricCallback(objectName, index, "kips", getStat, (UInt64(i) << 8) | METRIC_KIPS));
+   }
+   Sim()->getStatsManager()->registerMetric(new StatsMetricCallback("host_global", 0, "elapsed_ns", getStat, (UInt64(s_num_cores) << 8) | METRIC_ELAPSED));
+
+   s_enabled = true;
+}
+
+void HostProfiler::fini()
+{
+   if (!s_enabled)
+      return;
+
+   UInt64 elapsed = Timer::now() - s_time_start;
+   UInt64 totals[NUM_COMPONENTS] = { 0 }, total = 0, instructions = 0;
+   for(UInt32 i = 0; i < s_num_cores; ++i)
+   {
+      for(UInt32 c = 0; c < NUM_COMPONENTS; ++c)
+      {
+         totals[c] += cyclesToNs(getCycles(i, c));
+         total += cyclesToNs(getCycles(i, c));
+      }
+      instructions += Sim()->getCoreManager()->getCoreFromID(i)->getInstructionCount();
+   }
+
+   printf("[SNIPER] Host time breakdown (summed over %u cores, %.1f s wall time):\n", s_num_cores, elapsed / 1e9);
+   for(UInt32 c = 0; c < NUM_COMPONENTS; ++c)
+      printf("[SNIPER]   %-12s %10.2f s  %5.1f%%\n", component_names[c], totals[c] / 1e9, total ? 100. * totals[c] / total : 0.);
+   for(UInt32 c = 0; c < NUM_COMPONENTS; ++c)
+      if (getCycles(s_num_cores, c))
+         printf("[SNIPER]   %-12s %10.2f s  (not on a core)\n", component_names[c], cyclesToNs(getCycles(s_num_cores, c)) / 1e9);
+   printf("[SNIPER]   Simulation speed %.2f MIPS (%.2f MIPS per core)\n",
+      elapsed ? 1e3 * instructions / elapsed : 0., elapsed ? 1e3 * instructions / elapsed / s_num_cores : 0.);
+   fflush(stdout);
+
+   s_enabled = false;
+}
+
+UInt64 HostProfiler::cyclesToNs(UInt64 cycles)
+{
+   // Calibrate rdtsc against wall time over the whole run so far
+   UInt64 d_time = Timer::now() - s_time_start, d_rdtsc = rdtsc() - s_rdtsc_start;
+   return d_rdtsc ? UInt64(double(cycles) * d_time / d_rdtsc) : 0;
+}
+
+UInt64 HostProfiler::getStat(String objectName, UInt32 index, String metricName, UInt64 arg)
+{
+   UInt32 slot = arg >> 8, metric = arg & 0xff;
+   if (metric < NUM_COMPONENTS)
+      return cyclesToNs(getCycles(slot, metric));
+   UInt64 elapsed = Timer::now() - s_time_start;
+   if (metric == METRIC_ELAPSED)
+      return elapsed;
+   else
+      return elapsed ? 1000000 * Sim()->getCoreManager()->getCoreFromID(slot)->getInstructionCount() / elapsed : 0;
+}
+
+UInt64 HostProfiler::getCycles(UInt32 index, UInt32 component)
+{
+   // Flushed totals, plus what threads currently on this core have not flushed yet
+   UInt64 cycles = s_totals[index].cycles[component];
+   if (index < s_num_cores)
+   {
+      ScopedLock sl(s_slots_lock);
+      for(std::vector<Slot*>::iterator it = s_slots.begin(); it != s_slots.end(); ++it)
+         if ((*it)->core_id == (core_id_t)index)
+            cycles += (*it)->cycles[component];
+   }
+   return cycles;
+}
+
+HostProfiler::Slot* HostProfiler::getThreadSlot()
+{
+   static thread_local Slot *t_slot = NULL;
+   if (!t_slot)
+   {
+      t_slot = (Slot*)aligned_alloc(sizeof(Slot), sizeof(Slot));
+      memset(t_slot, 0, sizeof(Slot));
+      t_slot->current = OTHER;
+      t_slot->t_last = rdtsc();
+      t_slot->core_id = INVALID_CORE_ID;
+      // Kept after the thread exits, its time still counts towards its last core
+      ScopedLock sl(s_slots_lock);
+      s_slots.push_back(t_slot);
+   }
+   return t_slot;
+}
+
+void HostProfiler::flushSlot(Slot &slot)
+{
+   // The thread moved to a different core: hand what it accumulated to its previous core
+   if (slot.core_id != INVALID_CORE_ID)
+   {
+      for(UInt32 c = 0; c < NUM_COMPONENTS; ++c)
+      {
+         __sync_fetch_and_add(&s_totals[slot.core_id].cycles[c], slot.cycles[c]);
+         slot.cycles[c] = 0;
+      }
+   }
+}
+
+void HostProfiler::Scoped::enter(component_t component)
+{
+   UInt64 now = rdtsc();
+   core_id_t core_id = Sim()->getCoreManager()->getCurrentCoreID();
+   m_entered = true;
+   if (core_id == INVALID_CORE_ID || core_id >= (core_id_t)s_num_cores)
+   {
+      // Not on a core: inclusive accounting in the global entry
+      m_inclusive = true;
+      m_previous = component;
+      m_start = now;
+   }
+   else
+   {
+      Slot &slot = *getThreadSlot();
+      if (slot.core_id != core_id)
+      {
+         flushSlot(slot);
+         slot.core_id = core_id;
+      }
+      slot.cycles[slot.current] += now - slot.t_last;
+      m_inclusive = false;
+      m_previous = slot.current;
+      slot.current = component;
+      slot.t_last = now;
+   }
+}
+
+void HostProfiler::Scoped::exit()
+{
+   UInt64 now = rdtsc();
+   if (m_inclusive)
+   {
+      __sync_fetch_and_add(&s_totals[s_num_cores].cycles[m_previous], now - m_start);
+   }
+   else
+   {
+      // Our own thread's slot, even if we were moved to a different core while in this scope
+      Slot &slot = *getThreadSlot();
+      slot.cycles[slot.current] += now - slot.t_last;
+      slot.current = m_previous;
+      slot.t_last = now;
+   }
+}
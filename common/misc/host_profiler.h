@@ -0,0 +1,92 @@
+#ifndef HOST_PROFILER_H
+#define HOST_PROFILER_H
+
+#include "fixed_types.h"
+#include "lock.h"
+
+#include <vector>
+
+// Breakdown of host (wall-clock) time over the main simulator components, using rdtsc.
+//
+// Time is accounted per host thread, so a scope that spans a wait (e.g. BARRIER) during which the thread is
+// rescheduled to a different core still enters and exits the same slot. Per-core totals add up the time of
+// the threads while they were on that core. Accounting is exclusive: when scopes nest (e.g. the cache hierarchy called from within the core model),
+// time spent in the inner scope is only charged to the inner component, and time outside of any scope
+// is charged to HostProfiler::OTHER (functional simulation, front-end, idle time).
+// Threads not running on a core are charged, inclusively, to a separate global entry.
+//
+// Enable with host_profile/enabled = true. When disabled, a scope costs a single (static) boolean check.
+class HostProfiler
+{
+   public:
+      enum component_t {
+         OTHER = 0,
+         CORE_MODEL,    // Core timing model (PerformanceModel::handleInstruction)
+         MEMORY,        // Cache hierarchy (CacheCntlr)
+         QUEUE_MODEL,   // Contention models (QueueModel::computeQueueDelay)
+         BARRIER,       // Clock skew minimization, including waiting for other cores
+         HOOKS,         // Hook callbacks (Python scripts, native plugins, schedulers, ...)
+         STATS,         // Writing statistics snapshots
+         NUM_COMPONENTS
+      };
+      static const char* component_names[];
+
+      static void init();
+      static void fini();
+      static bool isEnabled() { return s_enabled; }
+
+      class Scoped
+      {
+         public:
+            Scoped(component_t component)
+               : m_entered(false)
+            {
+               if (s_enabled)
+                  enter(component);
+            }
+            ~Scoped()
+            {
+               if (s_enabled && m_entered)
+                  exit();
+            }
+         private:
+            bool m_entered;
+            bool m_inclusive;
+            component_t m_previous;
+            UInt64 m_start;
+
+            void enter(component_t component);
+            void exit();
+      };
+
+   private:
+      // Per host thread, cycles are charged to core_id until the thread is seen on a different core
+      struct Slot
+      {
+         UInt64 cycles[NUM_COMPONENTS];
+         component_t current;
+         UInt64 t_last;
+         core_id_t core_id;
+      } __attribute__((aligned(64)));
+
+      struct Totals
+      {
+         UInt64 cycles[NUM_COMPONENTS];
+      } __attribute__((aligned(64)));
+
+      static bool s_enabled;
+      static UInt32 s_num_cores;
+      static Totals *s_totals;      // One per core, plus one global entry at the end
+      static Lock s_slots_lock;
+      static std::vector<Slot*> s_slots;
+      static UInt64 s_rdtsc_start;
+      static UInt64 s_time_start;
+
+      static Slot* getThreadSlot();
+      static void flushSlot(Slot &slot);
+      static UInt64 getCycles(UInt32 index, UInt32 component);
+      static UInt64 cyclesToNs(UInt64 cycles);
+      static UInt64 getStat(String objectName, UInt32 index, String metricName, UInt64 arg);
+};
+
+#endif // HOST_PROFILER_H
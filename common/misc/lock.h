@@ -22,6 +22,8 @@ public:
    virtual void release() = 0;
    virtual void acquire_read() { acquire(); }
    virtual void release_read() { release(); }
+   // Returns false if the lock is held by someone else (implementations without support just wait for it)
+   virtual bool try_acquire() { acquire(); return true; }
 };
 
 class LockCreator
@@ -53,6 +55,15 @@ public:
       #endif
    }
 
+   // Use a specific implementation (e.g. ContentionLock), ownership is transferred
+   explicit TLock(LockImplementation *lock)
+   {
+      _lock = lock;
+      #ifdef TIME_LOCKS
+      _timer = TotalTimer::getTimerByStacktrace("lock@" + itostr(this));
+      #endif
+   }
+
    ~TLock()
    {
       delete _lock;
@@ -0,0 +1,173 @@
+#include "packet_buffer_pool.h"
+#include "log.h"
+
+#include <cassert>
+
+PacketBufferPool::FreeList PacketBufferPool::s_free[PacketBufferPool::NUM_CLASSES];
+
+UInt32 PacketBufferPool::getSizeClass(UInt32 length)
+{
+   UInt32 size_class = 0;
+   while (size_class < NUM_CLASSES && length > (1u << (MIN_CLASS_BITS + size_class)))
+      ++size_class;
+   return size_class;
+}
+
+#ifndef NDEBUG
+PacketBufferPool::ThreadCache::ThreadCache()
+{
+   for(UInt32 size_class = 0; size_class < NUM_CLASSES; ++size_class)
+   {
+      num_local[size_class] = 0;
+      used_shared[size_class] = false;
+   }
+}
+#endif
+
+PacketBufferPool::ThreadCache::~ThreadCache()
+{
+   // Thread exit: hand everything back to the shared lists
+   for(UInt32 size_class = 0; size_class < NUM_CLASSES; ++size_class)
+      spill(*this, size_class, buffers[size_class].size());
+}
+
+PacketBufferPool::ThreadCache& PacketBufferPool::getCache()
+{
+   static thread_local ThreadCache cache;
+   return cache;
+}
+
+void PacketBufferPool::checkBatched(ThreadCache &cache, UInt32 size_class)
+{
+#ifndef NDEBUG
+   // After a refill or spill, the cache holds CACHE_BATCH buffers, and is only empty or full again
+   // after at least that many allocations or releases: the shared list lock is never taken per packet
+   LOG_ASSERT_ERROR(!cache.used_shared[size_class] || cache.num_local[size_class] >= CACHE_BATCH,
+      "Packet buffer size class %u went to the shared free list after only %" PRIu64 " local operations", size_class, cache.num_local[size_class]);
+   cache.num_local[size_class] = 0;
+   cache.used_shared[size_class] = true;
+#endif
+}
+
+void PacketBufferPool::refill(ThreadCache &cache, UInt32 size_class)
+{
+   std::vector<Header*> &buffers = cache.buffers[size_class];
+   checkBatched(cache, size_class);
+
+   {
+      FreeList &list = s_free[size_class];
+      ScopedLock sl(list.lock);
+      while (buffers.size() < CACHE_BATCH && !list.buffers.empty())
+      {
+         buffers.push_back(list.buffers.back());
+         list.buffers.pop_back();
+      }
+   }
+
+   while (buffers.size() < CACHE_BATCH)
+   {
+      Header *header = (Header*) new Byte[sizeof(Header) + (1u << (MIN_CLASS_BITS + size_class))];
+#ifndef NDEBUG
+      header->magic = MAGIC_FREE;
+#endif
+      buffers.push_back(header);
+   }
+}
+
+void PacketBufferPool::spill(ThreadCache &cache, UInt32 size_class, UInt32 count)
+{
+   std::vector<Header*> &buffers = cache.buffers[size_class];
+
+   {
+      FreeList &list = s_free[size_class];
+      ScopedLock sl(list.lock);
+      while (count && list.buffers.size() < MAX_FREE)
+      {
+         list.buffers.push_back(buffers.back());
+         buffers.pop_back();
+         --count;
+      }
+   }
+
+   // Shared list is full: free the rest
+   for( ; count; --count)
+   {
+      delete [] (Byte*)buffers.back();
+      buffers.pop_back();
+   }
+}
+
+Byte* PacketBufferPool::alloc(UInt32 length)
+{
+   UInt32 size_class = getSizeClass(length);
+   Header *header = NULL;
+
+   if (size_class < NUM_CLASSES)
+   {
+      ThreadCache &cache = getCache();
+      std::vector<Header*> &buffers = cache.buffers[size_class];
+      if (buffers.empty())
+         refill(cache, size_class);
+      header = buffers.back();
+      buffers.pop_back();
+      assert(header->magic == MAGIC_FREE);
+#ifndef NDEBUG
+      ++cache.num_local[size_class];
+#endif
+   }
+   else
+   {
+      size_class = HUGE_CLASS;
+      header = (Header*) new Byte[sizeof(Header) + length];
+   }
+
+#ifndef NDEBUG
+   header->magic = MAGIC_LIVE;
+#endif
+   header->refcount = 1;
+   header->size_class = size_class;
+   return (Byte*)header + sizeof(Header);
+}
+
+void PacketBufferPool::addRef(const void *buffer)
+{
+#ifndef NDEBUG
+   LOG_ASSERT_ERROR(getHeader(buffer)->magic == MAGIC_LIVE, "Taking a reference on %p, which is not a packet buffer in use", buffer);
+#endif
+   __sync_fetch_and_add(&getHeader(buffer)->refcount, 1);
+}
+
+void PacketBufferPool::release(const void *buffer)
+{
+   Header *header = getHeader(buffer);
+#ifndef NDEBUG
+   LOG_ASSERT_ERROR(header->magic == MAGIC_LIVE, "Releasing %p, which is not a packet buffer in use (not from PacketBufferPool::alloc, or already released)", buffer);
+#endif
+   LOG_ASSERT_ERROR(header->refcount > 0, "Releasing packet buffer %p which is not in use", buffer);
+
+   if (__sync_sub_and_fetch(&header->refcount, 1) > 0)
+      return;
+
+#ifndef NDEBUG
+   header->magic = MAGIC_FREE;
+#endif
+
+   if (header->size_class < NUM_CLASSES)
+   {
+      ThreadCache &cache = getCache();
+      std::vector<Header*> &buffers = cache.buffers[header->size_class];
+      buffers.push_back(header);
+#ifndef NDEBUG
+      ++cache.num_local[header->size_class];
+#endif
+      if (buffers.size() >= 2 * CACHE_BATCH)
+      {
+         checkBatched(cache, header->size_class);
+         spill(cache, header->size_class, CACHE_BATCH);
+      }
+   }
+   else
+   {
+      delete [] (Byte*)header;
+   }
+}
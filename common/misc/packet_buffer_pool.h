@@ -0,0 +1,69 @@
+#ifndef PACKET_BUFFER_POOL_H
+#define PACKET_BUFFER_POOL_H
+
+#include "fixed_types.h"
+#include "lock.h"
+
+#include <vector>
+
+// Pool of reference-counted buffers for network packets and transport messages.
+// Buffers come in power-of-two size classes and are recycled through per-class free lists,
+// larger buffers are allocated from the heap. Each thread keeps a small cache per size class, which is refilled
+// from and spilled to the shared free list CACHE_BATCH buffers at a time, so sending or receiving a packet
+// does not take a lock (debug builds assert this). A buffer can be handed to several receivers
+// (e.g. broadcasts) by taking a reference for each of them, the last release() returns it to the pool.
+// Buffers start after a header, so they must never be passed to delete []. Debug builds tag the header
+// and assert that addRef() and release() only see buffers that are currently in use.
+
+class PacketBufferPool
+{
+   public:
+      static Byte* alloc(UInt32 length);
+      static void addRef(const void *buffer);
+      static void release(const void *buffer);
+
+   private:
+      static const UInt32 MIN_CLASS_BITS = 6;    // 64 bytes
+      static const UInt32 NUM_CLASSES = 7;       // up to 4 KiB
+      static const UInt32 MAX_FREE = 4096;       // Free buffers kept per size class in the shared lists
+      static const UInt32 CACHE_BATCH = 32;      // Buffers moved between a thread's cache and the shared list at once
+      static const UInt32 HUGE_CLASS = NUM_CLASSES;
+      static const UInt64 MAGIC_LIVE = 0x7061636b6c697665ULL;
+      static const UInt64 MAGIC_FREE = 0x7061636b66726565ULL;
+
+      struct Header
+      {
+         volatile UInt32 refcount;
+         UInt32 size_class;
+         UInt64 magic;    // MAGIC_LIVE or MAGIC_FREE (debug builds only), also keeps the payload 16-byte aligned
+      };
+
+      struct FreeList
+      {
+         Lock lock;
+         std::vector<Header*> buffers;
+      };
+
+      struct ThreadCache
+      {
+         std::vector<Header*> buffers[NUM_CLASSES];
+#ifndef NDEBUG
+         UInt64 num_local[NUM_CLASSES];     // Allocations and releases served from the cache since the last shared list access
+         bool used_shared[NUM_CLASSES];
+         ThreadCache();
+#endif
+         ~ThreadCache();
+      };
+
+      static FreeList s_free[NUM_CLASSES];
+
+      static ThreadCache& getCache();
+      static void refill(ThreadCache &cache, UInt32 size_class);
+      static void spill(ThreadCache &cache, UInt32 size_class, UInt32 count);
+      static void checkBatched(ThreadCache &cache, UInt32 size_class);
+
+      static Header* getHeader(const void *buffer) { return (Header*)((Byte*)buffer - sizeof(Header)); }
+      static UInt32 getSizeClass(UInt32 length);
+};
+
+#endif // PACKET_BUFFER_POOL_H
@@ -20,6 +20,11 @@ void PthreadLock::release()
    pthread_mutex_unlock(&_mutx);
 }
 
+bool PthreadLock::try_acquire()
+{
+   return pthread_mutex_trylock(&_mutx) == 0;
+}
+
 __attribute__((weak)) LockImplementation* LockCreator_Default::create()
 {
     return new PthreadLock();
@@ -13,6 +13,7 @@ public:
 
    void acquire();
    void release();
+   bool try_acquire();
 
 private:
    pthread_mutex_t _mutx;
@@ -1,9 +1,35 @@
 #include "setlock.h"
+#include "timer.h"
 #include <assert.h>
+#include <sched.h>
 
-_SetLock::_SetLock(UInt32 core_offset, UInt32 num_sharers)
-   : m_locks(num_sharers)
+#define WAIT_WHILE(condition)                      \
+   /* First busy wait a little */                  \
+   for(int i = 0; i < 10000 && (condition); ++i) ; \
+   while(condition) {                              \
+      /* Then reschedule */                        \
+      sched_yield();                               \
+   }
+
+_SetLock::_SetLock(UInt32 core_offset, UInt32 num_sharers, SetLockStats* stats)
+   : m_state(0)
+   , m_writers_waiting(0)
    , m_core_offset(core_offset)
+   , m_num_sharers(num_sharers)
+   , m_stats(stats)
+{
+   #ifdef TIME_LOCKS
+   _timer = TotalTimer::getTimerByStacktrace("setlock@" + itostr(this));
+   #endif
+}
+
+// Only used to fill the per-set vector, copies start out unlocked
+_SetLock::_SetLock(const _SetLock& other)
+   : m_state(0)
+   , m_writers_waiting(0)
+   , m_core_offset(other.m_core_offset)
+   , m_num_sharers(other.m_num_sharers)
+   , m_stats(other.m_stats)
 {
    #ifdef TIME_LOCKS
    _timer = TotalTimer::getTimerByStacktrace("setlock@" + itostr(this));
@@ -18,16 +44,40 @@ _SetLock::acquire_exclusive(void)
    ScopedTimer tt(*_timer);
    #endif
 
-   for(std::vector<PersetLock>::iterator it = m_locks.begin(); it != m_locks.end(); ++it)
-      (*it).acquire();
+   // Fast path: no readers, no writer
+   if (__sync_bool_compare_and_swap(&m_state, 0, WRITER))
+      return;
+
+   Timer t_wait;
+
+   // Tell readers we want to write, so no new ones come in
+   __sync_add_and_fetch(&m_writers_waiting, 1);
+
+   while(true) {
+      // Wait until the current writer and all readers have left
+      WAIT_WHILE(m_state != 0);
+
+      // Another writer may have beaten us
+      if (__sync_bool_compare_and_swap(&m_state, 0, WRITER))
+         break;
+   }
+
+   __sync_sub_and_fetch(&m_writers_waiting, 1);
+
+   if (m_stats) {
+      __sync_fetch_and_add(&m_stats->exclusive_contended, 1);
+      __sync_fetch_and_add(&m_stats->wait_time, t_wait.getTime());
+   }
 }
 
 // Release exclusive access
 void
 _SetLock::release_exclusive(void)
 {
-   for(std::vector<PersetLock>::iterator it = m_locks.begin(); it != m_locks.end(); ++it)
-      (*it).release();
+   assert(m_state & WRITER);
+
+   // Readers backing off may still have their increment outstanding, so only clear our bit
+   __sync_fetch_and_and(&m_state, ~WRITER);
 }
 
 // Acquire shared access
@@ -39,20 +89,50 @@ _SetLock::acquire_shared(UInt32 core_id)
    #endif
 
    assert(core_id >= m_core_offset);
-   assert(core_id < m_core_offset + m_locks.size());
-   m_locks.at(core_id - m_core_offset).acquire();
+   assert(core_id < m_core_offset + m_num_sharers);
+
+   if (m_writers_waiting == 0)
+   {
+      // Fast path: no writer holding or waiting for the lock
+      if ((__sync_fetch_and_add(&m_state, 1) & WRITER) == 0)
+         return;
+      // A writer got there first, undo our increment
+      __sync_sub_and_fetch(&m_state, 1);
+   }
+
+   Timer t_wait;
+
+   while(true) {
+      // Writers have preference: wait until the current writer has left, and any waiting writers got in
+      WAIT_WHILE((m_state & WRITER) || m_writers_waiting);
+
+      if ((__sync_fetch_and_add(&m_state, 1) & WRITER) == 0)
+         break;
+
+      // A writer came in between, back off and retry
+      __sync_sub_and_fetch(&m_state, 1);
+   }
+
+   if (m_stats) {
+      __sync_fetch_and_add(&m_stats->shared_contended, 1);
+      __sync_fetch_and_add(&m_stats->wait_time, t_wait.getTime());
+   }
 }
 
 // Release shared access
 void
 _SetLock::release_shared(UInt32 core_id)
 {
-   m_locks.at(core_id - m_core_offset).release();
+   assert((m_state & ~WRITER) > 0);
+
+   __sync_sub_and_fetch(&m_state, 1);
 }
 
 void
 _SetLock::upgrade(UInt32 core_id)
 {
+   // If two threads decide to upgrade at the same time, we could deadlock.
+   // Therefore, release our shared access first
    release_shared(core_id);
    acquire_exclusive();
 }
@@ -60,7 +140,9 @@ _SetLock::upgrade(UInt32 core_id)
 void
 _SetLock::downgrade(UInt32 core_id)
 {
-   for(unsigned int i = 0; i < m_locks.size(); ++i)
-      if (i != (core_id - m_core_offset))
-         m_locks.at(i).release();
+   assert(m_state & WRITER);
+
+   // Become a reader before giving up the write lock, so no writer can come in inbetween
+   __sync_add_and_fetch(&m_state, 1);
+   __sync_fetch_and_and(&m_state, ~WRITER);
 }
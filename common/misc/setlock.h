@@ -9,10 +9,27 @@
 
 /* Cache set lock */
 
+// Contention counters, shared by all set locks of one cache.
+// Only updated (atomically) when a lock could not be acquired immediately.
+struct SetLockStats
+{
+   UInt64 shared_contended;
+   UInt64 exclusive_contended;
+   UInt64 wait_time;             // Host time spent waiting, in ns
+
+   SetLockStats() : shared_contended(0), exclusive_contended(0), wait_time(0) {}
+};
+
+// Reader/writer lock with writer preference. Shared (per-core) and exclusive (whole stack) access
+// both cost a single atomic operation on one word when uncontended, independent of the number of sharers.
+// Readers keep out while a writer is waiting, so a stream of shared accesses cannot starve a writer.
+// Each lock fills a cache line: locks of neighbouring sets are stored next to each other, and are
+// often held by different cores at the same time.
 class _SetLock
 {
    public:
-      _SetLock(UInt32 core_offset, UInt32 num_sharers);
+      _SetLock(UInt32 core_offset, UInt32 num_sharers, SetLockStats* stats = NULL);
+      _SetLock(const _SetLock& other);
       void acquire_exclusive(void);
       void release_exclusive(void);
       void acquire_shared(UInt32 core_id);
@@ -21,23 +38,24 @@ class _SetLock
       void downgrade(UInt32 core_id);
 
    private:
-      class PersetLock
-      {
-         public:
-            PersetLock() { pthread_mutex_init(&_mutx, NULL); }
-            void acquire() { pthread_mutex_lock(&_mutx); }
-            void release() { pthread_mutex_unlock(&_mutx); }
-         private:
-            pthread_mutex_t _mutx;
-      } __attribute__ ((aligned (64)));
-
-      std::vector<PersetLock> m_locks;
+      static const UInt32 WRITER = 0x80000000;
+      static const UInt32 CACHE_LINE_SIZE = 64;
+
+      volatile UInt32 m_state;            // WRITER bit, plus the number of readers in the low bits
+      volatile UInt32 m_writers_waiting;
       UInt32 m_core_offset;
+      UInt32 m_num_sharers;
+      SetLockStats* m_stats;
       #ifdef TIME_LOCKS
       TotalTimer* _timer;
+      char m_padding[CACHE_LINE_SIZE - 4 * sizeof(UInt32) - 2 * sizeof(void*)];
+      #else
+      char m_padding[CACHE_LINE_SIZE - 4 * sizeof(UInt32) - sizeof(void*)];
       #endif
 };
 
+static_assert(sizeof(_SetLock) == 64, "_SetLock should fill exactly one cache line");
+
 class _SELock : SELock
 {
    public:
@@ -3,6 +3,8 @@
 #include "hooks_manager.h"
 #include "utils.h"
 #include "itostr.h"
+#include "config.hpp"
+#include "host_profiler.h"
 
 #include <math.h>
 #include <stdio.h>
@@ -31,6 +33,7 @@ const char* db_create_stmts[] = {
 const char db_insert_stmt_name[] = "INSERT INTO `names` (nameid, objectname, metricname) VALUES (?, ?, ?);";
 const char db_insert_stmt_prefix[] = "INSERT INTO `prefixes` (prefixid, prefixname) VALUES (?, ?);";
 const char db_insert_stmt_value[] = "INSERT INTO `values` (prefixid, nameid, core, value) VALUES (?, ?, ?, ?);";
+const char db_insert_stmt_event[] = "INSERT INTO `event` (event, time, core, thread, value0, value1, description) VALUES (?, ?, ?, ?, ?, ?, ?);";
 
 UInt64 getWallclockTimeCallback(String objectName, UInt32 index, String metricName, UInt64 arg)
 {
@@ -44,6 +47,12 @@ StatsManager::StatsManager()
    : m_keyid(0)
    , m_prefixnum(0)
    , m_db(NULL)
+   , m_db_vacuum(false)
+   , m_event_stream(NULL)
+   , m_snapshot_epoch(0)
+   , m_snapshot_full_requested(false)
+   , m_snapshot_full(false)
+   , m_snapshot_reader_valid(false)
 {
    init();
 
@@ -59,11 +68,30 @@ StatsManager::~StatsManager()
 
    if (m_db)
    {
+      // Write out any events logged after the last statistics snapshot
+      {
+         ScopedLock sl(m_event_lock);
+         if (!m_events.empty())
+         {
+            sqlite3_exec(m_db, "BEGIN TRANSACTION", NULL, NULL, NULL);
+            flushEvents();
+            sqlite3_exec(m_db, "END TRANSACTION", NULL, NULL, NULL);
+         }
+      }
+
+      // We have deleted snapshots, reclaim free space now
+      if (m_db_vacuum)
+         sqlite3_exec(m_db, "VACUUM", NULL, NULL, NULL);
+
       sqlite3_finalize(m_stmt_insert_name);
       sqlite3_finalize(m_stmt_insert_prefix);
       sqlite3_finalize(m_stmt_insert_value);
+      sqlite3_finalize(m_stmt_insert_event);
       sqlite3_close(m_db);
    }
+
+   if (m_event_stream)
+      fclose(m_event_stream);
 }
 
 void
@@ -89,6 +117,17 @@ StatsManager::init()
    sqlite3_prepare(m_db, db_insert_stmt_name, -1, &m_stmt_insert_name, NULL);
    sqlite3_prepare(m_db, db_insert_stmt_prefix, -1, &m_stmt_insert_prefix, NULL);
    sqlite3_prepare(m_db, db_insert_stmt_value, -1, &m_stmt_insert_value, NULL);
+   sqlite3_prepare(m_db, db_insert_stmt_event, -1, &m_stmt_insert_event, NULL);
+
+   m_event_buffer_size = Sim()->getCfg()->getInt("stats/events/buffer_size");
+   m_events.reserve(m_event_buffer_size);
+
+   if (Sim()->getCfg()->getBool("stats/events/binary_markers"))
+   {
+      String filename_events = Sim()->getConfig()->formatOutputFileName("sim.events.bin");
+      m_event_stream = fopen(filename_events.c_str(), "w");
+      LOG_ASSERT_ERROR(m_event_stream, "Cannot create event stream %s", filename_events.c_str());
+   }
 
    sqlite3_exec(m_db, "BEGIN TRANSACTION", NULL, NULL, NULL);
    for(StatsObjectList::iterator it1 = m_objects.begin(); it1 != m_objects.end(); ++it1)
@@ -130,10 +169,48 @@ StatsManager::recordStats(String prefix)
 {
    LOG_ASSERT_ERROR(m_db, "m_db not yet set up !?");
 
-   // Allow lazily-maintained statistics to be updated
-   Sim()->getHooksManager()->callHooks(HookType::HOOK_PRE_STAT_WRITE, (UInt64)prefix.c_str());
+   HostProfiler::Scoped hp(HostProfiler::STATS);
+
+   if (isSnapshotReader())
+   {
+      // HOOK_PRE_STAT_WRITE callbacks change simulator state, so they can only run at the barrier, before the snapshot
+      LOG_ASSERT_ERROR(m_snapshot_full, "Pipelined HOOK_PERIODIC observers can only write statistics after requesting a full snapshot at the barrier");
+   }
+   else
+   {
+      // Allow lazily-maintained statistics to be updated
+      Sim()->getHooksManager()->callHooks(HookType::HOOK_PRE_STAT_WRITE, (UInt64)prefix.c_str());
+   }
+
+   // Collect the metrics under the registry lock (threads may be registering new ones, possibly while
+   // we run on the pipelined HOOK_PERIODIC service thread), but read them outside of it
+   std::vector<std::pair<UInt64, StatsMetricBase *> > metrics;
+   {
+      ScopedLock sl(m_registry_lock);
+      metrics.reserve(m_metrics.size());
+      for(StatsObjectList::iterator it1 = m_objects.begin(); it1 != m_objects.end(); ++it1)
+         for (StatsMetricList::iterator it2 = it1->second.begin(); it2 != it1->second.end(); ++it2)
+            for(StatsIndexList::iterator it3 = it2->second.second.begin(); it3 != it2->second.second.end(); ++it3)
+               metrics.push_back(std::make_pair(it2->second.first, it3->second));
+   }
+
+   // Read all values before taking m_event_lock: callback metrics can take the Python interpreter lock,
+   // while Python code holding that lock may be logging events or registering metrics
+   std::vector<MetricValue> values;
+   values.reserve(metrics.size());
+   for(std::vector<std::pair<UInt64, StatsMetricBase *> >::iterator it = metrics.begin(); it != metrics.end(); ++it)
+   {
+      UInt64 value = readMetric(it->second);
+      if (!it->second->isDefault(value))
+         values.push_back(MetricValue(it->first, it->second->index, value));
+   }
 
    int res;
+
+   // Keep events from being flushed in a separate transaction while we're writing this snapshot
+   // (this also serializes recordStats() calls from pipelined HOOK_PERIODIC observers with other writers)
+   ScopedLock sl(m_event_lock);
+
    int prefixid = ++m_prefixnum;
 
    res = sqlite3_exec(m_db, "BEGIN TRANSACTION", NULL, NULL, NULL);
@@ -145,27 +222,49 @@ StatsManager::recordStats(String prefix)
    res = sqlite3_step(m_stmt_insert_prefix);
    LOG_ASSERT_ERROR(res == SQLITE_DONE, "Error executing SQL statement: %s", sqlite3_errmsg(m_db));
 
-   for(StatsObjectList::iterator it1 = m_objects.begin(); it1 != m_objects.end(); ++it1)
+   for(std::vector<MetricValue>::iterator it = values.begin(); it != values.end(); ++it)
    {
-      for (StatsMetricList::iterator it2 = it1->second.begin(); it2 != it1->second.end(); ++it2)
-      {
-         for(StatsIndexList::iterator it3 = it2->second.second.begin(); it3 != it2->second.second.end(); ++it3)
-         {
-            if (!it3->second->isDefault())
-            {
-               sqlite3_reset(m_stmt_insert_value);
-               sqlite3_bind_int(m_stmt_insert_value, 1, prefixid);
-               sqlite3_bind_int(m_stmt_insert_value, 2, it2->second.first);   // Metric ID
-               sqlite3_bind_int(m_stmt_insert_value, 3, it3->second->index);  // Core ID
-               sqlite3_bind_int64(m_stmt_insert_value, 4, it3->second->recordMetric());
-               res = sqlite3_step(m_stmt_insert_value);
-               LOG_ASSERT_ERROR(res == SQLITE_DONE, "Error executing SQL statement: %s", sqlite3_errmsg(m_db));
-            }
-         }
-      }
+      sqlite3_reset(m_stmt_insert_value);
+      sqlite3_bind_int(m_stmt_insert_value, 1, prefixid);
+      sqlite3_bind_int(m_stmt_insert_value, 2, it->nameid);   // Metric ID
+      sqlite3_bind_int(m_stmt_insert_value, 3, it->index);    // Core ID
+      sqlite3_bind_int64(m_stmt_insert_value, 4, it->value);
+      res = sqlite3_step(m_stmt_insert_value);
+      LOG_ASSERT_ERROR(res == SQLITE_DONE, "Error executing SQL statement: %s", sqlite3_errmsg(m_db));
    }
+
+   flushEvents();
+
    res = sqlite3_exec(m_db, "END TRANSACTION", NULL, NULL, NULL);
    LOG_ASSERT_ERROR(res == SQLITE_OK, "Error executing SQL statement: %s", sqlite3_errmsg(m_db));
+
+   if (m_event_stream)
+      fflush(m_event_stream);
+}
+
+void
+StatsManager::deleteStats(String prefix)
+{
+   LOG_ASSERT_ERROR(m_db, "m_db not yet set up !?");
+
+   ScopedLock sl(m_event_lock);
+
+   sqlite3_stmt *stmt;
+   sqlite3_prepare(m_db, "SELECT prefixid FROM prefixes WHERE prefixname = ?;", -1, &stmt, NULL);
+   sqlite3_bind_text(stmt, 1, prefix.c_str(), -1, SQLITE_TRANSIENT);
+   if (sqlite3_step(stmt) == SQLITE_ROW)
+   {
+      int prefixid = sqlite3_column_int(stmt, 0);
+      char query[128];
+      sqlite3_exec(m_db, "BEGIN TRANSACTION", NULL, NULL, NULL);
+      snprintf(query, sizeof(query), "DELETE FROM prefixes WHERE prefixid = %d;", prefixid);
+      sqlite3_exec(m_db, query, NULL, NULL, NULL);
+      snprintf(query, sizeof(query), "DELETE FROM `values` WHERE prefixid = %d;", prefixid);
+      sqlite3_exec(m_db, query, NULL, NULL, NULL);
+      sqlite3_exec(m_db, "END TRANSACTION", NULL, NULL, NULL);
+      m_db_vacuum = true;
+   }
+   sqlite3_finalize(stmt);
 }
 
 void
@@ -173,9 +272,12 @@ StatsManager::registerMetric(StatsMetricBase *metric)
 {
    std::string _objectName(metric->objectName.c_str()), _metricName(metric->metricName.c_str());
 
+   ScopedLock sl(m_registry_lock);
+
    LOG_ASSERT_ERROR(m_objects[_objectName][_metricName].second.count(metric->index) == 0,
       "Duplicate statistic %s.%s[%d]", _objectName.c_str(), _metricName.c_str(), metric->index);
    m_objects[_objectName][_metricName].second[metric->index] = metric;
+   m_metrics.push_back(metric);
 
    if (m_objects[_objectName][_metricName].first == 0)
    {
@@ -192,13 +294,86 @@ StatsMetricBase *
 StatsManager::getMetricObject(String objectName, UInt32 index, String metricName)
 {
    std::string _objectName(objectName.c_str()), _metricName(metricName.c_str());
-   if (m_objects.count(_objectName) == 0)
+   ScopedLock sl(m_registry_lock);
+
+   StatsObjectList::iterator it1 = m_objects.find(_objectName);
+   if (it1 == m_objects.end())
       return NULL;
-   if (m_objects[_objectName].count(_metricName) == 0)
+   StatsMetricList::iterator it2 = it1->second.find(_metricName);
+   if (it2 == it1->second.end())
       return NULL;
-   if (m_objects[_objectName][_metricName].second.count(index) == 0)
+   StatsIndexList::iterator it3 = it2->second.second.find(index);
+   if (it3 == it2->second.second.end())
       return NULL;
-   return m_objects[_objectName][_metricName].second[index];
+   return it3->second;
+}
+
+void
+StatsManager::takeSnapshot()
+{
+   // Called at the barrier after the previous batch of pipelined observers has completed, so nobody is reading snapshot values
+   ++m_snapshot_epoch;
+   m_snapshot_full = m_snapshot_full_requested;
+   m_snapshot_full_requested = false;
+
+   if (m_snapshot_full)
+   {
+      Sim()->getHooksManager()->callHooks(HookType::HOOK_PRE_STAT_WRITE, (UInt64)"");
+
+      // Application threads can still register metrics (e.g. on thread creation), and callback metrics
+      // may take the Python interpreter lock: copy the list rather than holding the registry lock while reading
+      std::vector<StatsMetricBase *> metrics;
+      {
+         ScopedLock sl(m_registry_lock);
+         metrics = m_metrics;
+      }
+      for(std::vector<StatsMetricBase *>::iterator it = metrics.begin(); it != metrics.end(); ++it)
+      {
+         (*it)->snapshot = (*it)->recordMetric();
+         (*it)->snapshot_epoch = m_snapshot_epoch;
+      }
+   }
+   else
+   {
+      ScopedLock sl(m_snapshot_lock);
+      for(std::vector<StatsMetricBase *>::iterator it = m_snapshot_metrics.begin(); it != m_snapshot_metrics.end(); ++it)
+      {
+         (*it)->snapshot = (*it)->recordMetric();
+         (*it)->snapshot_epoch = m_snapshot_epoch;
+      }
+   }
+}
+
+UInt64
+StatsManager::readSnapshot(StatsMetricBase *metric)
+{
+   if (metric->snapshot_epoch == m_snapshot_epoch)
+      return metric->snapshot;
+
+   // Not copied at this barrier: copy it from now on, but this first read can only return the live value
+   {
+      ScopedLock sl(m_snapshot_lock);
+      if (!metric->snapshot_tracked)
+      {
+         metric->snapshot_tracked = true;
+         m_snapshot_metrics.push_back(metric);
+      }
+   }
+   return metric->recordMetric();
+}
+
+void
+StatsManager::setSnapshotReader(bool enabled)
+{
+   if (enabled)
+   {
+      m_snapshot_reader = pthread_self();
+      m_snapshot_reader_valid = true;
+   }
+   else
+   {
+      m_snapshot_reader_valid = false;
+   }
 }
 
 void
@@ -220,18 +395,55 @@ StatsManager::logEvent(event_type_t event, SubsecondTime time, core_id_t core_id
    if (time == SubsecondTime::MaxTime())
       time = Sim()->getClockSkewMinimizationServer()->getGlobalTime();
 
-   sqlite3_stmt *stmt;
-   sqlite3_prepare(m_db, "INSERT INTO event (event, time, core, thread, value0, value1, description) VALUES (?, ?, ?, ?, ?, ?, ?);", -1, &stmt, NULL);
-   sqlite3_bind_int(stmt, 1, event);
-   sqlite3_bind_int64(stmt, 2, time.getFS());
-   sqlite3_bind_int(stmt, 3, core_id);
-   sqlite3_bind_int(stmt, 4, thread_id);
-   sqlite3_bind_int64(stmt, 5, value0);
-   sqlite3_bind_int64(stmt, 6, value1);
-   sqlite3_bind_text(stmt, 7, description ? description : "", -1, SQLITE_STATIC);
-   int res = sqlite3_step(stmt);
-   LOG_ASSERT_ERROR(res == SQLITE_DONE, "Error executing SQL statement: %s", sqlite3_errmsg(m_db));
-   sqlite3_finalize(stmt);
+   ScopedLock sl(m_event_lock);
+
+   if (m_event_stream && event == EVENT_MARKER)
+   {
+      EventRecord record;
+      record.event = event;
+      record.description_length = description ? strlen(description) : 0;
+      record.time = time.getFS();
+      record.core_id = core_id;
+      record.thread_id = thread_id;
+      record.value0 = value0;
+      record.value1 = value1;
+      fwrite(&record, sizeof(record), 1, m_event_stream);
+      if (record.description_length)
+         fwrite(description, record.description_length, 1, m_event_stream);
+      return;
+   }
+
+   m_events.push_back(Event(event, time, core_id, thread_id, value0, value1, description));
+
+   if (m_events.size() >= m_event_buffer_size)
+   {
+      int res;
+      res = sqlite3_exec(m_db, "BEGIN TRANSACTION", NULL, NULL, NULL);
+      LOG_ASSERT_ERROR(res == SQLITE_OK, "Error executing SQL statement: %s", sqlite3_errmsg(m_db));
+      flushEvents();
+      res = sqlite3_exec(m_db, "END TRANSACTION", NULL, NULL, NULL);
+      LOG_ASSERT_ERROR(res == SQLITE_OK, "Error executing SQL statement: %s", sqlite3_errmsg(m_db));
+   }
+}
+
+void
+StatsManager::flushEvents()
+{
+   // Caller holds m_event_lock and has started a transaction
+   for(std::vector<Event>::iterator it = m_events.begin(); it != m_events.end(); ++it)
+   {
+      sqlite3_reset(m_stmt_insert_event);
+      sqlite3_bind_int(m_stmt_insert_event, 1, it->event);
+      sqlite3_bind_int64(m_stmt_insert_event, 2, it->time.getFS());
+      sqlite3_bind_int(m_stmt_insert_event, 3, it->core_id);
+      sqlite3_bind_int(m_stmt_insert_event, 4, it->thread_id);
+      sqlite3_bind_int64(m_stmt_insert_event, 5, it->value0);
+      sqlite3_bind_int64(m_stmt_insert_event, 6, it->value1);
+      sqlite3_bind_text(m_stmt_insert_event, 7, it->description.c_str(), -1, SQLITE_STATIC);
+      int res = sqlite3_step(m_stmt_insert_event);
+      LOG_ASSERT_ERROR(res == SQLITE_DONE, "Error executing SQL statement: %s", sqlite3_errmsg(m_db));
+   }
+   m_events.clear();
 }
 
 StatHist &
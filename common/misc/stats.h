@@ -2,9 +2,13 @@
 
 #include "simulator.h"
 #include "itostr.h"
+#include "lock.h"
 
 #include <strings.h>
+#include <stdio.h>
+#include <vector>
 #include <sqlite3.h>
+#include <pthread.h>
 
 class StatsMetricBase
 {
@@ -12,12 +16,16 @@ class StatsMetricBase
       String objectName;
       UInt32 index;
       String metricName;
+      // Value at the barrier for pipelined HOOK_PERIODIC observers, valid when snapshot_epoch matches the StatsManager's
+      UInt64 snapshot;
+      UInt64 snapshot_epoch;
+      bool snapshot_tracked;
       StatsMetricBase(String _objectName, UInt32 _index, String _metricName) :
-         objectName(_objectName), index(_index), metricName(_metricName)
+         objectName(_objectName), index(_index), metricName(_metricName), snapshot(0), snapshot_epoch(0), snapshot_tracked(false)
       {}
       virtual ~StatsMetricBase() {}
       virtual UInt64 recordMetric() = 0;
-      virtual bool isDefault() { return false; } // Return true when value hasn't changed from its initialization value
+      virtual bool isDefault(UInt64 value) { return false; } // Return true when value (as read) is still the initialization value
 };
 
 template <class T> UInt64 makeStatsValue(T t);
@@ -33,9 +41,9 @@ template <class T> class StatsMetric : public StatsMetricBase
       {
          return makeStatsValue<T>(*metric);
       }
-      virtual bool isDefault()
+      virtual bool isDefault(UInt64 value)
       {
-         return recordMetric() == 0;
+         return value == 0;
       }
 };
 
@@ -72,21 +80,75 @@ class StatsManager
       ~StatsManager();
       void init();
       void recordStats(String prefix);
+      void deleteStats(String prefix);
       void registerMetric(StatsMetricBase *metric);
       StatsMetricBase *getMetricObject(String objectName, UInt32 index, String metricName);
+      // Snapshot statistics at the barrier, before pipelined HOOK_PERIODIC observers are started.
+      // Only metrics that pipelined observers have read before are copied: the first read of a metric returns its live value.
+      // When requestFullSnapshot() was called at this barrier (by a synchronous HOOK_PERIODIC callback),
+      // HOOK_PRE_STAT_WRITE is run and all metrics are copied, so pipelined observers can also use recordStats().
+      // While setSnapshotReader(true) is in effect for the calling thread, readMetric() and recordStats() return snapshot values.
+      void requestFullSnapshot() { m_snapshot_full_requested = true; }
+      void takeSnapshot();
+      void setSnapshotReader(bool enabled);
+      UInt64 readMetric(StatsMetricBase *metric)
+      { return isSnapshotReader() ? readSnapshot(metric) : metric->recordMetric(); }
       void logTopology(String component, core_id_t core_id, core_id_t master_id);
       void logMarker(SubsecondTime time, core_id_t core_id, thread_id_t thread_id, UInt64 value0, UInt64 value1, const char * description)
       { logEvent(EVENT_MARKER, time, core_id, thread_id, value0, value1, description); }
       void logEvent(event_type_t event, SubsecondTime time, core_id_t core_id, thread_id_t thread_id, UInt64 value0, UInt64 value1, const char * description);
 
    private:
+      struct Event
+      {
+         event_type_t event;
+         SubsecondTime time;
+         core_id_t core_id;
+         thread_id_t thread_id;
+         UInt64 value0, value1;
+         String description;
+         Event(event_type_t _event, SubsecondTime _time, core_id_t _core_id, thread_id_t _thread_id, UInt64 _value0, UInt64 _value1, const char * _description)
+            : event(_event), time(_time), core_id(_core_id), thread_id(_thread_id), value0(_value0), value1(_value1), description(_description ? _description : "")
+         {}
+      };
+
+      // Binary event stream record, followed by description_length bytes of description (no terminating zero)
+      struct EventRecord
+      {
+         UInt32 event;
+         UInt32 description_length;
+         UInt64 time;
+         SInt32 core_id;
+         SInt32 thread_id;
+         UInt64 value0;
+         UInt64 value1;
+      } __attribute__((packed));
+
+      struct MetricValue
+      {
+         UInt64 nameid;
+         UInt32 index;
+         UInt64 value;
+         MetricValue(UInt64 _nameid, UInt32 _index, UInt64 _value) : nameid(_nameid), index(_index), value(_value) {}
+      };
+
       UInt64 m_keyid;
       UInt64 m_prefixnum;
 
       sqlite3 *m_db;
+      bool m_db_vacuum;
       sqlite3_stmt *m_stmt_insert_name;
       sqlite3_stmt *m_stmt_insert_prefix;
       sqlite3_stmt *m_stmt_insert_value;
+      sqlite3_stmt *m_stmt_insert_event;
+
+      // Events are buffered in memory, and written out in a single transaction
+      // at every statistics snapshot or when the buffer is full
+      Lock m_event_lock;
+      std::vector<Event> m_events;
+      UInt64 m_event_buffer_size;
+      // Optional binary stream for high-frequency marker events
+      FILE *m_event_stream;
 
       // Use std::string here because String (__versa_string) does not provide a hash function for STL containers with gcc < 4.6
       typedef std::unordered_map<UInt64, StatsMetricBase *> StatsIndexList;
@@ -94,11 +156,30 @@ class StatsManager
       typedef std::unordered_map<std::string, StatsMetricWithKey> StatsMetricList;
       typedef std::unordered_map<std::string, StatsMetricList> StatsObjectList;
       StatsObjectList m_objects;
+      // Flat list of all metrics, so a full snapshot does not need to walk the hash maps
+      std::vector<StatsMetricBase *> m_metrics;
+      // Protects m_objects and m_metrics: metrics are registered by application threads (e.g. on thread creation)
+      // while recordStats() and getMetricObject() may run on the pipelined HOOK_PERIODIC service thread.
+      // Never held while reading a metric, callback metrics may take the Python interpreter lock.
+      Lock m_registry_lock;
+      // Metrics read by pipelined observers, copied at every barrier
+      std::vector<StatsMetricBase *> m_snapshot_metrics;
+      Lock m_snapshot_lock;
+      UInt64 m_snapshot_epoch;
+      bool m_snapshot_full_requested;
+      bool m_snapshot_full;
+
+      bool m_snapshot_reader_valid;
+      pthread_t m_snapshot_reader;
+      bool isSnapshotReader() const
+      { return m_snapshot_reader_valid && pthread_equal(m_snapshot_reader, pthread_self()); }
+      UInt64 readSnapshot(StatsMetricBase *metric);
 
       static int __busy_handler(void* self, int count) { return ((StatsManager*)self)->busy_handler(count); }
       int busy_handler(int count);
 
       void recordMetricName(UInt64 keyId, std::string objectName, std::string metricName);
+      void flushEvents();
 };
 
 template <class T> void registerStatsMetric(String objectName, UInt32 index, String metricName, T *metric)
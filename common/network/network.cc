@@ -1,4 +1,5 @@
 #include <string.h>
+#include <algorithm>
 
 #include "transport.h"
 #include "core.h"
@@ -10,6 +11,7 @@
 #include "subsecond_time.h"
 #include "performance_model.h"
 #include "instruction.h"
+#include "packet_buffer_pool.h"
 
 // FIXME: Rework netCreateBuf and netExPacket. We don't need to
 // duplicate the sender/receiver info the packet. This should be known
@@ -19,6 +21,9 @@
 
 Network::Network(Core *core)
       : _core(core)
+      , _remotePackets(0)
+      , _netQueueSize(0)
+      , _netQueueSeq(0)
 {
    LOG_ASSERT_ERROR(sizeof(g_type_to_static_network_map) / sizeof(EStaticNetwork) == NUM_PACKET_TYPES,
                     "Static network type map has incorrect number of entries.");
@@ -96,7 +101,7 @@ void Network::netPullFromTransport()
          if (packet.receiver != NetPacket::BROADCAST)
          {
             if (packet.length > 0)
-               delete [] (Byte*) packet.data;
+               NetPacket::releaseData(packet.data);
             continue;
          }
       }
@@ -118,7 +123,7 @@ void Network::netPullFromTransport()
          callback(_callbackObjs[packet.type], packet);
 
          if (packet.length > 0)
-            delete [] (Byte*) packet.data;
+            NetPacket::releaseData(packet.data);
       }
 
       // synchronous I/O support
@@ -127,7 +132,8 @@ void Network::netPullFromTransport()
          LOG_PRINT("Enqueuing packet : type %i, from %i, to %i, core_id %i, time %s.",
                (SInt32)packet.type, packet.sender, packet.receiver, _core->getId(), itostr(packet.time).c_str());
          _netQueueLock.acquire();
-         _netQueue.push_back(packet);
+         _netQueue[netQueueKey(packet.type, packet.sender)].push_back(NetQueueEntry(packet, _netQueueSeq++));
+         ++_netQueueSize;
          _netQueueLock.release();
          _netQueueCond.broadcast();
       }
@@ -139,7 +145,7 @@ void Network::netPullFromTransport()
 
 void Network::forwardPacket(NetPacket& packet)
 {
-   netSend(packet);
+   netSend(packet, true);
 }
 
 NetworkModel* Network::getNetworkModelFromPacketType(PacketType packet_type)
@@ -147,18 +153,38 @@ NetworkModel* Network::getNetworkModelFromPacketType(PacketType packet_type)
    return _models[g_type_to_static_network_map[packet_type]];
 }
 
-SInt32 Network::netSend(NetPacket& packet)
+SInt32 Network::netSend(NetPacket& packet, bool pooled)
 {
    assert(packet.type >= 0 && packet.type < NUM_PACKET_TYPES);
 
    NetworkModel *model = _models[g_type_to_static_network_map[packet.type]];
 
    model->countPacket(packet);
+   if (packet.receiver != packet.sender)
+      ++_remotePackets;
 
    std::vector<NetworkModel::Hop> hopVec;
    model->routePacket(packet, hopVec);
 
-   Byte *buffer = packet.makeBuffer();
+   // The payload is shared by all hops, only the header is copied for each of them
+   const void *payload = NULL;
+   if (packet.length > 0)
+   {
+      if (pooled)
+      {
+         payload = packet.data;
+         PacketBufferPool::addRef(payload);
+      }
+      else
+      {
+         Byte *buffer = PacketBufferPool::alloc(packet.length);
+         memcpy(buffer, packet.data, packet.length);
+         payload = buffer;
+      }
+   }
+
+   NetPacket header = packet;
+   header.data = payload;
    SubsecondTime start_time = packet.time;
 
    for (UInt32 i = 0; i < hopVec.size(); i++)
@@ -188,122 +214,53 @@ SInt32 Network::netSend(NetPacket& packet)
          }
       }
 
-      NetPacket* buff_pkt = (NetPacket*) buffer;
+      if (_core->getId() == header.sender)
+         header.start_time = start_time;
 
-      if (_core->getId() == buff_pkt->sender)
-         buff_pkt->start_time = start_time;
+      header.time = hopVec[i].time;
+      header.receiver = hopVec[i].final_dest;
 
-      buff_pkt->time = hopVec[i].time;
-      buff_pkt->receiver = hopVec[i].final_dest;
-
-      _transport->send(hopVec[i].next_dest, buffer, packet.bufferSize());
+      // Each receiver releases its own reference
+      if (payload)
+         PacketBufferPool::addRef(payload);
+      _transport->send(hopVec[i].next_dest, &header, sizeof(header));
 
       LOG_PRINT("Sent packet");
    }
 
-   delete [] buffer;
+   if (payload)
+      PacketBufferPool::release(payload);
 
    return packet.length;
 }
 
-// Stupid helper class to eliminate special cases for empty
-// sender/type vectors in a NetMatch
-class NetRecvIterator
+// Find the earliest packet in a (type, sender) queue, and keep it if it is earlier than the one found so far.
+// Ties are broken on arrival order, so the choice does not depend on the order in which queues are visited.
+bool Network::netQueueFind(NetQueue *queue, NetQueue *&found_queue, NetQueue::iterator &found)
 {
-   public:
-      NetRecvIterator(UInt32 i)
-            : _mode(INT)
-            , _max(i)
-            , _i(0)
-      {
-      }
-      NetRecvIterator(const std::vector<SInt32> &v)
-            : _mode(SENDER_VECTOR)
-            , _senders(&v)
-            , _i(0)
-      {
-      }
-      NetRecvIterator(const std::vector<PacketType> &v)
-            : _mode(TYPE_VECTOR)
-            , _types(&v)
-            , _i(0)
-      {
-      }
-
-      inline UInt32 get()
-      {
-         switch (_mode)
-         {
-         case INT:
-            return _i;
-         case SENDER_VECTOR:
-            return (UInt32)_senders->at(_i);
-         case TYPE_VECTOR:
-            return (UInt32)_types->at(_i);
-         default:
-            assert(false);
-            return (UInt32)-1;
-         };
-      }
-
-      inline Boolean done()
-      {
-         switch (_mode)
-         {
-         case INT:
-            return _i >= _max;
-         case SENDER_VECTOR:
-            return _i >= _senders->size();
-         case TYPE_VECTOR:
-            return _i >= _types->size();
-         default:
-            assert(false);
-            return true;
-         };
-      }
-
-      inline void next()
-      {
-         ++_i;
-      }
-
-      inline void reset()
+   bool any = false;
+   for (NetQueue::iterator i = queue->begin(); i != queue->end(); i++)
+   {
+      if (found_queue == NULL || found->packet.time > i->packet.time
+          || (found->packet.time == i->packet.time && found->seq > i->seq))
       {
-         _i = 0;
+         found_queue = queue;
+         found = i;
       }
-
-   private:
-      enum
-      {
-         INT, SENDER_VECTOR, TYPE_VECTOR
-      } _mode;
-
-      union
-      {
-         UInt32 _max;
-         const std::vector<SInt32> *_senders;
-         const std::vector<PacketType> *_types;
-      };
-
-      UInt32 _i;
-};
+      any = true;
+   }
+   return any;
+}
 
 NetPacket Network::netRecv(const NetMatch &match, UInt64 timeout_ns)
 {
    LOG_PRINT("Entering netRecv.");
 
    // Track via iterator to minimize copying
+   NetQueue *queue = NULL;
    NetQueue::iterator itr;
    Boolean found = false, retry = true;
 
-   NetRecvIterator sender = match.senders.empty()
-                            ? NetRecvIterator(_numMod)
-                            : NetRecvIterator(match.senders);
-
-   NetRecvIterator type = match.types.empty()
-                          ? NetRecvIterator((UInt32)NUM_PACKET_TYPES)
-                          : NetRecvIterator(match.types);
-
    LOG_ASSERT_ERROR(_core && _core->getPerformanceModel(),
                     "Core and/or performance model not initialized.");
    SubsecondTime start_time = _core->getPerformanceModel()->getElapsedTime();
@@ -312,33 +269,38 @@ NetPacket Network::netRecv(const NetMatch &match, UInt64 timeout_ns)
 
    while (!found)
    {
-      itr = _netQueue.end();
+      queue = NULL;
 
-      // check every entry in the queue
-      for (NetQueue::iterator i = _netQueue.begin();
-            i != _netQueue.end();
-            i++)
+      if (_netQueueSize == 0)
+      {
+         // Nothing queued at all, no need to look
+      }
+      else if (!match.senders.empty() && !match.types.empty())
+      {
+         // Fully specified match: look up each (type, sender) pair directly
+         for (std::vector<PacketType>::const_iterator type = match.types.begin(); type != match.types.end(); ++type)
+            for (std::vector<SInt32>::const_iterator sender = match.senders.begin(); sender != match.senders.end(); ++sender)
+            {
+               NetQueueIndex::iterator entry = _netQueue.find(netQueueKey(*type, *sender));
+               if (entry != _netQueue.end())
+                  found |= netQueueFind(&entry->second, queue, itr);
+            }
+      }
+      else
       {
-         // only find packets that match
-         for (sender.reset(); !sender.done(); sender.next())
+         // Wildcard on sender and/or type: check all non-empty queues
+         for (NetQueueIndex::iterator entry = _netQueue.begin(); entry != _netQueue.end(); ++entry)
          {
-            if (i->sender != (SInt32)sender.get())
+            if (entry->second.empty())
                continue;
 
-            for (type.reset(); !type.done(); type.next())
-            {
-               if (i->type != (PacketType)type.get())
-                  continue;
-
-               found = true;
+            const NetPacket &head = entry->second.front().packet;
+            if (!match.senders.empty() && std::find(match.senders.begin(), match.senders.end(), head.sender) == match.senders.end())
+               continue;
+            if (!match.types.empty() && std::find(match.types.begin(), match.types.end(), head.type) == match.types.end())
+               continue;
 
-               // find the earliest packet
-               if (itr == _netQueue.end() ||
-                   itr->time > i->time)
-               {
-                  itr = i;
-               }
-            }
+            found |= netQueueFind(&entry->second, queue, itr);
          }
       }
 
@@ -362,14 +324,15 @@ NetPacket Network::netRecv(const NetMatch &match, UInt64 timeout_ns)
       }
    }
 
-   assert(found == true && itr != _netQueue.end());
-   assert(0 <= itr->sender && itr->sender < _numMod);
-   assert(0 <= itr->type && itr->type < NUM_PACKET_TYPES);
-   assert((itr->receiver == _core->getId()) || (itr->receiver == NetPacket::BROADCAST));
+   assert(found == true && queue != NULL && itr != queue->end());
+   assert(0 <= itr->packet.sender && itr->packet.sender < _numMod);
+   assert(0 <= itr->packet.type && itr->packet.type < NUM_PACKET_TYPES);
+   assert((itr->packet.receiver == _core->getId()) || (itr->packet.receiver == NetPacket::BROADCAST));
 
    // Copy result
-   NetPacket packet = *itr;
-   _netQueue.erase(itr);
+   NetPacket packet = itr->packet;
+   queue->erase(itr);
+   --_netQueueSize;
    _netQueueLock.release();
 
    LOG_PRINT("packet.time(%s), start_time(%s)", itostr(packet.time).c_str(), itostr(start_time).c_str());
@@ -507,17 +470,11 @@ NetPacket::NetPacket(SubsecondTime t, PacketType ty, SInt32 s,
 
 NetPacket::NetPacket(Byte *buffer)
 {
+   // Transport messages only carry the header, the payload (if any) is a shared PacketBufferPool buffer
+   // to which the sender took a reference on our behalf
    memcpy(this, buffer, sizeof(*this));
 
-   // LOG_ASSERT_ERROR(length > 0, "type(%u), sender(%i), receiver(%i), length(%u)", type, sender, receiver, length);
-   if (length > 0)
-   {
-      Byte* data_buffer = new Byte[length];
-      memcpy(data_buffer, buffer + sizeof(*this), length);
-      data = data_buffer;
-   }
-
-   delete [] buffer;
+   PacketBufferPool::release(buffer);
 }
 
 // This implementation is slightly wasteful because there is no need
@@ -540,3 +497,13 @@ Byte* NetPacket::makeBuffer() const
 
    return buffer;
 }
+
+Byte* NetPacket::allocData(UInt32 length)
+{
+   return PacketBufferPool::alloc(length);
+}
+
+void NetPacket::releaseData(const void *data)
+{
+   PacketBufferPool::release(data);
+}
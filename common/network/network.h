@@ -11,6 +11,7 @@
 #include <iostream>
 #include <vector>
 #include <list>
+#include <unordered_map>
 
 // TODO: Do we need to support multicast to some (but not all)
 // destinations?
@@ -40,10 +41,27 @@ public:
    UInt32 bufferSize() const;
    Byte *makeBuffer() const;
 
+   // Payload buffers that can be filled in place and sent without copying (see Network::netSend).
+   // Received packets also carry their payload in such a buffer: netRecv() callers release it with releaseData
+   // (never delete []), callbacks only borrow it for the duration of the call.
+   static Byte *allocData(UInt32 length);
+   static void releaseData(const void *data);
+
    static const SInt32 BROADCAST = 0xDEADBABE;
 };
 
-typedef std::list<NetPacket> NetQueue;
+// Received packet waiting for netRecv(), with its arrival order on this node.
+// Packets with equal times are returned in arrival order, independent of the index layout.
+struct NetQueueEntry
+{
+   NetPacket packet;
+   UInt64 seq;
+
+   NetQueueEntry(const NetPacket &_packet, UInt64 _seq) : packet(_packet), seq(_seq) {}
+};
+typedef std::list<NetQueueEntry> NetQueue;
+// Received packets waiting for netRecv(), indexed by (type, sender)
+typedef std::unordered_map<UInt64, NetQueue> NetQueueIndex;
 
 // -- Network Matches -- //
 
@@ -82,13 +100,19 @@ class Network
 
       // -- Main interface -- //
 
-      SInt32 netSend(NetPacket& packet);
+      // pooled: packet.data was allocated with NetPacket::allocData, and is passed on by reference
+      // (the caller still releases its own reference afterwards). Otherwise, the payload is copied once.
+      SInt32 netSend(NetPacket& packet, bool pooled = false);
+      // The returned packet's data (when length > 0) is a reference-counted PacketBufferPool buffer owned by the caller:
+      // release it with NetPacket::releaseData(packet.data), never with delete [] (it does not start a heap block).
+      // Debug builds assert when releasing a buffer that is not a live pool buffer.
       NetPacket netRecv(const NetMatch &match, UInt64 timeout_ns = 0);
 
       // -- Wrappers -- //
 
       SInt32 netSend(SInt32 dest, PacketType type, const void *buf, UInt32 len);
       SInt32 netBroadcast(PacketType type, const void *buf, UInt32 len);
+      // Same payload ownership as netRecv(const NetMatch&) above: release with NetPacket::releaseData
       NetPacket netRecv(SInt32 src, PacketType type, UInt64 timeout_ns = 0);
       NetPacket netRecvFrom(SInt32 src, UInt64 timeout_ns = 0);
       NetPacket netRecvType(PacketType type, UInt64 timeout_ns = 0);
@@ -102,6 +126,9 @@ class Network
       // Modeling
       UInt32 getModeledLength(const NetPacket& pkt);
 
+      // Number of packets sent to other cores (approximate: not updated atomically), used as a measure of inter-core interaction
+      UInt64 getRemotePacketCount() const { return _remotePackets; }
+
    private:
       NetworkModel * _models[NUM_STATIC_NETWORKS];
 
@@ -113,11 +140,17 @@ class Network
 
       SInt32 _tid;
       SInt32 _numMod;
+      UInt64 _remotePackets;
 
-      NetQueue _netQueue;
+      NetQueueIndex _netQueue;
+      UInt64 _netQueueSize;
+      UInt64 _netQueueSeq;
       Lock _netQueueLock;
       ConditionVariable _netQueueCond;
 
+      static UInt64 netQueueKey(PacketType type, SInt32 sender) { return (UInt64(type) << 32) | UInt32(sender); }
+      bool netQueueFind(NetQueue *queue, NetQueue *&found_queue, NetQueue::iterator &found);
+
       void forwardPacket(NetPacket& packet);
 };
 
@@ -116,8 +116,6 @@ NetworkModelEMeshHopByHop::createQueueModels(String name)
 void
 NetworkModelEMeshHopByHop::routePacket(const NetPacket &pkt, std::vector<Hop> &nextHops)
 {
-   ScopedLock sl(m_lock);
-
    core_id_t requester = INVALID_CORE_ID;
 
    if (pkt.type == SHARED_MEM_1)
@@ -134,8 +132,8 @@ NetworkModelEMeshHopByHop::routePacket(const NetPacket &pkt, std::vector<Hop> &n
 
    if (pkt.sender == m_core_id)
    {
-      m_total_packets_sent ++;
-      m_total_bytes_sent += pkt_length;
+      __sync_fetch_and_add(&m_total_packets_sent, 1);
+      __sync_fetch_and_add(&m_total_bytes_sent, pkt_length);
    }
 
    if (pkt.receiver == NetPacket::BROADCAST)
@@ -224,8 +222,6 @@ NetworkModelEMeshHopByHop::routePacket(const NetPacket &pkt, std::vector<Hop> &n
 void
 NetworkModelEMeshHopByHop::processReceivedPacket(NetPacket& pkt)
 {
-   ScopedLock sl(m_lock);
-
    UInt32 pkt_length = getNetwork()->getModeledLength(pkt);
 
    core_id_t requester = INVALID_CORE_ID;
@@ -327,6 +323,7 @@ NetworkModelEMeshHopByHop::computeLatency(OutputDirection direction, SubsecondTi
    SubsecondTime queue_delay = SubsecondTime::Zero();
    if (m_queue_model_enabled)
    {
+      ScopedLock sl(m_queue_locks[direction]);
       queue_delay = m_queue_models[direction]->computeQueueDelay(pkt_time, processing_time);
       if (queue_delay_stats)
          *queue_delay_stats += queue_delay;
@@ -350,6 +347,7 @@ NetworkModelEMeshHopByHop::computeInjectionPortQueueDelay(core_id_t pkt_receiver
       return SubsecondTime::Zero();
 
    SubsecondTime processing_time = computeProcessingTime(pkt_length);
+   ScopedLock sl(m_injection_port_lock);
    return m_injection_port_queue_model->computeQueueDelay(pkt_time, processing_time);
 }
 
@@ -362,6 +360,7 @@ NetworkModelEMeshHopByHop::computeEjectionPortQueueDelay(SubsecondTime pkt_time,
       return SubsecondTime::Zero();
 
    SubsecondTime processing_time = computeProcessingTime(pkt_length);
+   ScopedLock sl(m_ejection_port_lock);
    return m_ejection_port_queue_model->computeQueueDelay(pkt_time, processing_time);
 }
 
@@ -36,10 +36,13 @@ class NetworkModelEMeshHopByHop : public NetworkModel
 
       bool m_enabled;
 
-      // Lock
-      Lock m_lock;
+      // Locks: one per queue model, so packets using different links of this node are modeled concurrently.
+      // Routing itself only reads configuration, and packets are only received by this node's network thread.
+      Lock m_queue_locks[NUM_OUTPUT_DIRECTIONS];
+      Lock m_injection_port_lock;
+      Lock m_ejection_port_lock;
 
-      // Counters
+      // Counters (sent counters are updated atomically, packets can be sent by multiple threads)
       UInt64 m_total_bytes_sent;
       UInt64 m_total_packets_sent;
       UInt64 m_total_bytes_received;
@@ -10,6 +10,7 @@
 #include "core_manager.h"
 #include "config.hpp"
 #include "stats.h"
+#include "host_profiler.h"
 #include "dvfs_manager.h"
 #include "instruction_tracer.h"
 #include "dynamic_instruction.h"
@@ -306,7 +307,10 @@ void PerformanceModel::iterate()
       LOG_ASSERT_ERROR(!ins->instruction->isIdle(), "Idle instructions should not make it here!");
 
       if (!m_fastforward && m_enabled)
+      {
+         HostProfiler::Scoped hp(HostProfiler::CORE_MODEL);
          handleInstruction(ins);
+      }
 
       delete ins;
 
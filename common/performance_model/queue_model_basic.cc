@@ -1,6 +1,7 @@
 #include "queue_model_basic.h"
 #include "utils.h"
 #include "log.h"
+#include "host_profiler.h"
 
 QueueModelBasic::QueueModelBasic(String name, UInt32 id,
       bool moving_avg_enabled,
@@ -22,6 +23,8 @@ QueueModelBasic::~QueueModelBasic()
 SubsecondTime
 QueueModelBasic::computeQueueDelay(SubsecondTime pkt_time, SubsecondTime processing_time, core_id_t requester)
 {
+   HostProfiler::Scoped hp(HostProfiler::QUEUE_MODEL);
+
    // Compute the moving average here
    SubsecondTime ref_time;
    if (m_moving_average)
@@ -1,4 +1,5 @@
 #include "queue_model_contention.h"
+#include "host_profiler.h"
 
 QueueModelContention::QueueModelContention(String name, UInt32 id, UInt32 num_outstanding)
    : m_contention(name, id, num_outstanding)
@@ -9,6 +10,8 @@ QueueModelContention::~QueueModelContention()
 
 SubsecondTime QueueModelContention::computeQueueDelay(SubsecondTime pkt_time, SubsecondTime processing_time, core_id_t requester)
 {
+   HostProfiler::Scoped hp(HostProfiler::QUEUE_MODEL);
+
    SubsecondTime t_start = pkt_time;
    SubsecondTime t_delay = processing_time;
    SubsecondTime t_complete = m_contention.getCompletionTime(t_start, t_delay);
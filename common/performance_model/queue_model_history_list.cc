@@ -5,6 +5,7 @@
 #include "fxsupport.h"
 #include "log.h"
 #include "stats.h"
+#include "host_profiler.h"
 #include "config.hpp"
 
 QueueModelHistoryList::QueueModelHistoryList(String name, UInt32 id, SubsecondTime min_processing_time):
@@ -55,6 +56,8 @@ QueueModelHistoryList::~QueueModelHistoryList()
 SubsecondTime
 QueueModelHistoryList::computeQueueDelay(SubsecondTime pkt_time, SubsecondTime processing_time, core_id_t requester)
 {
+   HostProfiler::Scoped hp(HostProfiler::QUEUE_MODEL);
+
    LOG_ASSERT_ERROR(m_free_interval_list.size() >= 1,
          "Free Interval list size < 1");
 
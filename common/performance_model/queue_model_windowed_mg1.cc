@@ -3,6 +3,7 @@
 #include "config.hpp"
 #include "log.h"
 #include "stats.h"
+#include "host_profiler.h"
 
 QueueModelWindowedMG1::QueueModelWindowedMG1(String name, UInt32 id)
    : m_window_size(SubsecondTime::NS(Sim()->getCfg()->getInt("queue_model/windowed_mg1/window_size")))
@@ -24,6 +25,8 @@ QueueModelWindowedMG1::~QueueModelWindowedMG1()
 SubsecondTime
 QueueModelWindowedMG1::computeQueueDelay(SubsecondTime pkt_time, SubsecondTime processing_time, core_id_t requester)
 {
+   HostProfiler::Scoped hp(HostProfiler::QUEUE_MODEL);
+
    SubsecondTime t_queue = SubsecondTime::Zero();
 
    // Advance the window based on the global (barrier) time, as this guarantees the earliest time any thread may be at.
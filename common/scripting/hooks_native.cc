@@ -0,0 +1,48 @@
+#include "hooks_native.h"
+#include "sniper_plugin.h"
+#include "simulator.h"
+#include "config.hpp"
+#include "log.h"
+
+#include <dlfcn.h>
+
+std::vector<void*> HooksNative::s_handles;
+
+void HooksNative::init()
+{
+   UInt64 numscripts = Sim()->getCfg()->getInt("hooks/numscripts");
+   for(UInt64 i = 0; i < numscripts; ++i) {
+      String scriptname = Sim()->getCfg()->getString(String("hooks/script") + itostr(i) + "name");
+      if (scriptname.length() > 3 && scriptname.substr(scriptname.length()-3) == ".so") {
+         String args = Sim()->getCfg()->getString(String("hooks/script") + itostr(i) + "args");
+
+         printf("Loading native plugin %s\n", scriptname.c_str());
+         void *handle = dlopen(scriptname.c_str(), RTLD_NOW | RTLD_LOCAL);
+         if (!handle) {
+            fprintf(stderr, "Cannot open native plugin %s: %s\n", scriptname.c_str(), dlerror());
+            exit(-1);
+         }
+
+         SniperPluginInitFunc func_init = (SniperPluginInitFunc)dlsym(handle, SNIPER_PLUGIN_INIT_SYMBOL);
+         if (!func_init) {
+            fprintf(stderr, "Native plugin %s does not export %s()\n", scriptname.c_str(), SNIPER_PLUGIN_INIT_SYMBOL);
+            exit(-1);
+         }
+
+         s_handles.push_back(handle);
+         func_init(args.c_str());
+      }
+   }
+}
+
+void HooksNative::fini()
+{
+   for(std::vector<void*>::iterator it = s_handles.begin(); it != s_handles.end(); ++it)
+   {
+      SniperPluginFiniFunc func_fini = (SniperPluginFiniFunc)dlsym(*it, SNIPER_PLUGIN_FINI_SYMBOL);
+      if (func_fini)
+         func_fini();
+      // Do not dlclose(): callbacks into the plugin remain registered with the HooksManager
+   }
+   s_handles.clear();
+}
@@ -0,0 +1,19 @@
+#ifndef HOOKS_NATIVE_H
+#define HOOKS_NATIVE_H
+
+#include "fixed_types.h"
+
+#include <vector>
+
+// Loader for native (C++) hook plugins.
+// Any hooks/script<n>name ending in .so is dlopen()ed, and its exported sniper_plugin_init() function
+// is called with the script's arguments. See sniper_plugin.h for the plugin-side interface.
+class HooksNative {
+   public:
+      static void init(void);
+      static void fini(void);
+   private:
+      static std::vector<void*> s_handles;
+};
+
+#endif // HOOKS_NATIVE_H
@@ -4,8 +4,24 @@
 #include "config.hpp"
 #include "fxsupport.h"
 
+#include <pthread.h>
+
 bool HooksPy::pyInit = false;
 
+// The interpreter is not thread-safe, and with hooks/periodic_pipelined Python observers run on a service
+// thread concurrently with hooks called from application threads. Callbacks can nest (e.g. sim.stats.write()
+// calls HOOK_PRE_STAT_WRITE callbacks), so the lock needs to be recursive.
+static pthread_mutex_t s_py_lock;
+static pthread_once_t s_py_lock_once = PTHREAD_ONCE_INIT;
+static void initPythonLock()
+{
+   pthread_mutexattr_t attr;
+   pthread_mutexattr_init(&attr);
+   pthread_mutexattr_settype(&attr, PTHREAD_MUTEX_RECURSIVE);
+   pthread_mutex_init(&s_py_lock, &attr);
+   pthread_mutexattr_destroy(&attr);
+}
+
 void HooksPy::init()
 {
    UInt64 numscripts = Sim()->getCfg()->getInt("hooks/numscripts");
@@ -68,8 +84,21 @@ void HooksPy::fini()
       Py_Finalize();
 }
 
+void HooksPy::lockInterpreter()
+{
+   pthread_once(&s_py_lock_once, initPythonLock);
+   pthread_mutex_lock(&s_py_lock);
+}
+
+void HooksPy::unlockInterpreter()
+{
+   pthread_mutex_unlock(&s_py_lock);
+}
+
+// Callers should hold the interpreter lock (ScopedInterpreterLock) while building pArgs and using the result
 PyObject * HooksPy::callPythonFunction(PyObject *pFunc, PyObject *pArgs)
 {
+   ScopedInterpreterLock sl;
    PyObject *pResult = PyObject_CallObject(pFunc, pArgs);
    Py_XDECREF(pArgs);
    if (pResult == NULL) {
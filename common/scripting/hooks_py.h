@@ -15,6 +15,15 @@ class HooksPy {
       static void fini(void);
 
       static PyObject * callPythonFunction(PyObject *pFunc, PyObject *pArgs);
+
+      // Serializes access to the interpreter for callbacks made from C++ (recursive, callbacks can nest)
+      static void lockInterpreter(void);
+      static void unlockInterpreter(void);
+      class ScopedInterpreterLock {
+         public:
+            ScopedInterpreterLock() { HooksPy::lockInterpreter(); }
+            ~ScopedInterpreterLock() { HooksPy::unlockInterpreter(); }
+      };
    private:
       static bool pyInit;
 
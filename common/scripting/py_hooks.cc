@@ -21,18 +21,21 @@ static SInt64 hookCallbackResult(PyObject *pResult)
 
 static SInt64 hookCallbackNone(UInt64 pFunc, UInt64)
 {
+   HooksPy::ScopedInterpreterLock sl;
    PyObject *pResult = HooksPy::callPythonFunction((PyObject *)pFunc, NULL);
    return hookCallbackResult(pResult);
 }
 
 static SInt64 hookCallbackInt(UInt64 pFunc, UInt64 argument)
 {
+   HooksPy::ScopedInterpreterLock sl;
    PyObject *pResult = HooksPy::callPythonFunction((PyObject *)pFunc, Py_BuildValue("(L)", argument));
    return hookCallbackResult(pResult);
 }
 
 static SInt64 hookCallbackSubsecondTime(UInt64 pFunc, UInt64 argument)
 {
+   HooksPy::ScopedInterpreterLock sl;
    SubsecondTime time(*(subsecond_time_t*)&argument);
    PyObject *pResult = HooksPy::callPythonFunction((PyObject *)pFunc, Py_BuildValue("(L)", time.getFS()));
    return hookCallbackResult(pResult);
@@ -40,6 +43,7 @@ static SInt64 hookCallbackSubsecondTime(UInt64 pFunc, UInt64 argument)
 
 static SInt64 hookCallbackString(UInt64 pFunc, UInt64 _argument)
 {
+   HooksPy::ScopedInterpreterLock sl;
    const char* argument = (const char*)_argument;
    PyObject *pResult = HooksPy::callPythonFunction((PyObject *)pFunc, Py_BuildValue("(s)", argument));
    return hookCallbackResult(pResult);
@@ -47,6 +51,7 @@ static SInt64 hookCallbackString(UInt64 pFunc, UInt64 _argument)
 
 static SInt64 hookCallbackMagicMarkerType(UInt64 pFunc, UInt64 _argument)
 {
+   HooksPy::ScopedInterpreterLock sl;
    MagicServer::MagicMarkerType* argument = (MagicServer::MagicMarkerType*)_argument;
    PyObject *pResult = HooksPy::callPythonFunction((PyObject *)pFunc, Py_BuildValue("(iiKKs)", argument->thread_id, argument->core_id, argument->arg0, argument->arg1, argument->str));
    return hookCallbackResult(pResult);
@@ -54,6 +59,7 @@ static SInt64 hookCallbackMagicMarkerType(UInt64 pFunc, UInt64 _argument)
 
 static SInt64 hookCallbackThreadCreateType(UInt64 pFunc, UInt64 _argument)
 {
+   HooksPy::ScopedInterpreterLock sl;
    HooksManager::ThreadCreate* argument = (HooksManager::ThreadCreate*)_argument;
    PyObject *pResult = HooksPy::callPythonFunction((PyObject *)pFunc, Py_BuildValue("(ii)", argument->thread_id, argument->creator_thread_id));
    return hookCallbackResult(pResult);
@@ -61,6 +67,7 @@ static SInt64 hookCallbackThreadCreateType(UInt64 pFunc, UInt64 _argument)
 
 static SInt64 hookCallbackThreadTimeType(UInt64 pFunc, UInt64 _argument)
 {
+   HooksPy::ScopedInterpreterLock sl;
    HooksManager::ThreadTime* argument = (HooksManager::ThreadTime*)_argument;
    SubsecondTime time(argument->time);
    PyObject *pResult = HooksPy::callPythonFunction((PyObject *)pFunc, Py_BuildValue("(iL)", argument->thread_id, time.getFS()));
@@ -69,6 +76,7 @@ static SInt64 hookCallbackThreadTimeType(UInt64 pFunc, UInt64 _argument)
 
 static SInt64 hookCallbackThreadStallType(UInt64 pFunc, UInt64 _argument)
 {
+   HooksPy::ScopedInterpreterLock sl;
    HooksManager::ThreadStall* argument = (HooksManager::ThreadStall*)_argument;
    SubsecondTime time(argument->time);
    PyObject *pResult = HooksPy::callPythonFunction((PyObject *)pFunc, Py_BuildValue("(isL)", argument->thread_id, ThreadManager::stall_type_names[argument->reason], time.getFS()));
@@ -77,6 +85,7 @@ static SInt64 hookCallbackThreadStallType(UInt64 pFunc, UInt64 _argument)
 
 static SInt64 hookCallbackThreadResumeType(UInt64 pFunc, UInt64 _argument)
 {
+   HooksPy::ScopedInterpreterLock sl;
    HooksManager::ThreadResume* argument = (HooksManager::ThreadResume*)_argument;
    SubsecondTime time(argument->time);
    PyObject *pResult = HooksPy::callPythonFunction((PyObject *)pFunc, Py_BuildValue("(iiL)", argument->thread_id, argument->thread_by, time.getFS()));
@@ -85,6 +94,7 @@ static SInt64 hookCallbackThreadResumeType(UInt64 pFunc, UInt64 _argument)
 
 static SInt64 hookCallbackThreadMigrateType(UInt64 pFunc, UInt64 _argument)
 {
+   HooksPy::ScopedInterpreterLock sl;
    HooksManager::ThreadMigrate* argument = (HooksManager::ThreadMigrate*)_argument;
    SubsecondTime time(argument->time);
    PyObject *pResult = HooksPy::callPythonFunction((PyObject *)pFunc, Py_BuildValue("(iiL)", argument->thread_id, argument->core_id, time.getFS()));
@@ -93,6 +103,7 @@ static SInt64 hookCallbackThreadMigrateType(UInt64 pFunc, UInt64 _argument)
 
 static SInt64 hookCallbackSyscallEnter(UInt64 pFunc, UInt64 _argument)
 {
+   HooksPy::ScopedInterpreterLock sl;
    SyscallMdl::HookSyscallEnter* argument = (SyscallMdl::HookSyscallEnter*)_argument;
    SubsecondTime time(argument->time);
    PyObject *pResult = HooksPy::callPythonFunction((PyObject *)pFunc, Py_BuildValue("(iiLi(llllll))", argument->thread_id, argument->core_id, time.getFS(),
@@ -102,6 +113,7 @@ static SInt64 hookCallbackSyscallEnter(UInt64 pFunc, UInt64 _argument)
 
 static SInt64 hookCallbackSyscallExit(UInt64 pFunc, UInt64 _argument)
 {
+   HooksPy::ScopedInterpreterLock sl;
    SyscallMdl::HookSyscallExit* argument = (SyscallMdl::HookSyscallExit*)_argument;
    SubsecondTime time(argument->time);
    PyObject *pResult = HooksPy::callPythonFunction((PyObject *)pFunc, Py_BuildValue("(iiLiO)", argument->thread_id, argument->core_id, time.getFS(),
@@ -114,8 +126,9 @@ registerHook(PyObject *self, PyObject *args)
 {
    int hook = -1;
    PyObject *pFunc = NULL;
+   int order = HooksManager::ORDER_NOTIFY_PRE;
 
-   if (!PyArg_ParseTuple(args, "lO", &hook, &pFunc))
+   if (!PyArg_ParseTuple(args, "lO|l", &hook, &pFunc, &order))
       return NULL;
 
    if (hook < 0 || hook >= HookType::HOOK_TYPES_MAX) {
@@ -126,13 +139,21 @@ registerHook(PyObject *self, PyObject *args)
       PyErr_SetString(PyExc_TypeError, "Second argument must be callable");
       return NULL;
    }
+   if (order < 0 || order >= HooksManager::NUM_HOOK_ORDER) {
+      PyErr_SetString(PyExc_ValueError, "Hook order out of range");
+      return NULL;
+   }
+   if (order == HooksManager::ORDER_NOTIFY_PIPELINED && hook != HookType::HOOK_PERIODIC) {
+      PyErr_SetString(PyExc_ValueError, "ORDER_NOTIFY_PIPELINED is only supported for HOOK_PERIODIC");
+      return NULL;
+   }
 
    Py_INCREF(pFunc);
 
    HookType::hook_type_t type = HookType::hook_type_t(hook);
    switch(type) {
       case HookType::HOOK_PERIODIC:
-         Sim()->getHooksManager()->registerHook(type, hookCallbackSubsecondTime, (UInt64)pFunc);
+         Sim()->getHooksManager()->registerHook(type, hookCallbackSubsecondTime, (UInt64)pFunc, HooksManager::HookCallbackOrder(order));
          break;
       case HookType::HOOK_SIM_START:
       case HookType::HOOK_SIM_END:
@@ -141,7 +162,7 @@ registerHook(PyObject *self, PyObject *args)
       case HookType::HOOK_APPLICATION_ROI_BEGIN:
       case HookType::HOOK_APPLICATION_ROI_END:
       case HookType::HOOK_SIGUSR1:
-         Sim()->getHooksManager()->registerHook(type, hookCallbackNone, (UInt64)pFunc);
+         Sim()->getHooksManager()->registerHook(type, hookCallbackNone, (UInt64)pFunc, HooksManager::HookCallbackOrder(order));
          break;
       case HookType::HOOK_PERIODIC_INS:
       case HookType::HOOK_CPUFREQ_CHANGE:
@@ -149,36 +170,36 @@ registerHook(PyObject *self, PyObject *args)
       case HookType::HOOK_INSTRUMENT_MODE:
       case HookType::HOOK_APPLICATION_START:
       case HookType::HOOK_APPLICATION_EXIT:
-         Sim()->getHooksManager()->registerHook(type, hookCallbackInt, (UInt64)pFunc);
+         Sim()->getHooksManager()->registerHook(type, hookCallbackInt, (UInt64)pFunc, HooksManager::HookCallbackOrder(order));
          break;
       case HookType::HOOK_PRE_STAT_WRITE:
-         Sim()->getHooksManager()->registerHook(type, hookCallbackString, (UInt64)pFunc);
+         Sim()->getHooksManager()->registerHook(type, hookCallbackString, (UInt64)pFunc, HooksManager::HookCallbackOrder(order));
          break;
       case HookType::HOOK_MAGIC_MARKER:
       case HookType::HOOK_MAGIC_USER:
-         Sim()->getHooksManager()->registerHook(type, hookCallbackMagicMarkerType, (UInt64)pFunc);
+         Sim()->getHooksManager()->registerHook(type, hookCallbackMagicMarkerType, (UInt64)pFunc, HooksManager::HookCallbackOrder(order));
          break;
       case HookType::HOOK_THREAD_CREATE:
-         Sim()->getHooksManager()->registerHook(type, hookCallbackThreadCreateType, (UInt64)pFunc);
+         Sim()->getHooksManager()->registerHook(type, hookCallbackThreadCreateType, (UInt64)pFunc, HooksManager::HookCallbackOrder(order));
          break;
       case HookType::HOOK_THREAD_START:
       case HookType::HOOK_THREAD_EXIT:
-         Sim()->getHooksManager()->registerHook(type, hookCallbackThreadTimeType, (UInt64)pFunc);
+         Sim()->getHooksManager()->registerHook(type, hookCallbackThreadTimeType, (UInt64)pFunc, HooksManager::HookCallbackOrder(order));
          break;
       case HookType::HOOK_THREAD_STALL:
-         Sim()->getHooksManager()->registerHook(type, hookCallbackThreadStallType, (UInt64)pFunc);
+         Sim()->getHooksManager()->registerHook(type, hookCallbackThreadStallType, (UInt64)pFunc, HooksManager::HookCallbackOrder(order));
          break;
       case HookType::HOOK_THREAD_RESUME:
-         Sim()->getHooksManager()->registerHook(type, hookCallbackThreadResumeType, (UInt64)pFunc);
+         Sim()->getHooksManager()->registerHook(type, hookCallbackThreadResumeType, (UInt64)pFunc, HooksManager::HookCallbackOrder(order));
          break;
       case HookType::HOOK_THREAD_MIGRATE:
-         Sim()->getHooksManager()->registerHook(type, hookCallbackThreadMigrateType, (UInt64)pFunc);
+         Sim()->getHooksManager()->registerHook(type, hookCallbackThreadMigrateType, (UInt64)pFunc, HooksManager::HookCallbackOrder(order));
          break;
       case HookType::HOOK_SYSCALL_ENTER:
-         Sim()->getHooksManager()->registerHook(type, hookCallbackSyscallEnter, (UInt64)pFunc);
+         Sim()->getHooksManager()->registerHook(type, hookCallbackSyscallEnter, (UInt64)pFunc, HooksManager::HookCallbackOrder(order));
          break;
       case HookType::HOOK_SYSCALL_EXIT:
-         Sim()->getHooksManager()->registerHook(type, hookCallbackSyscallExit, (UInt64)pFunc);
+         Sim()->getHooksManager()->registerHook(type, hookCallbackSyscallExit, (UInt64)pFunc, HooksManager::HookCallbackOrder(order));
          break;
       case HookType::HOOK_TYPES_MAX:
          assert(0);
@@ -219,4 +240,12 @@ void HooksPy::PyHooks::setup()
       Py_DECREF(pGlobalConst);
    }
    Py_DECREF(pHooks);
+
+   const char *order_names[] = { "ORDER_NOTIFY_PRE", "ORDER_ACTION", "ORDER_NOTIFY_POST", "ORDER_NOTIFY_PIPELINED" };
+   static_assert(HooksManager::NUM_HOOK_ORDER == sizeof(order_names) / sizeof(order_names[0]), "Not enough values in order_names");
+   for(int i = 0; i < int(HooksManager::NUM_HOOK_ORDER); ++i) {
+      PyObject *pGlobalConst = PyInt_FromLong(i);
+      PyObject_SetAttrString(pModule, order_names[i], pGlobalConst);
+      Py_DECREF(pGlobalConst);
+   }
 }
@@ -26,7 +26,7 @@ getStatsValue(PyObject *self, PyObject *args)
       return NULL;
    }
 
-   return PyLong_FromUnsignedLongLong(metric->recordMetric());
+   return PyLong_FromUnsignedLongLong(Sim()->getStatsManager()->readMetric(metric));
 }
 
 
@@ -44,7 +44,7 @@ statsGetterGet(PyObject *self, PyObject *args, PyObject *kw)
 {
    statsGetterObject *getter = (statsGetterObject *)self;
    StatsMetricBase *metric = getter->metric;
-   return PyLong_FromUnsignedLongLong(metric->recordMetric());
+   return PyLong_FromUnsignedLongLong(Sim()->getStatsManager()->readMetric(metric));
 }
 
 static PyTypeObject statsGetterType = {
@@ -139,12 +139,26 @@ writeStats(PyObject *self, PyObject *args)
 }
 
 
+//////////
+// request_full_snapshot(): let pipelined HOOK_PERIODIC observers see all statistics, and write them, at this barrier
+//////////
+
+static PyObject *
+requestFullSnapshot(PyObject *self, PyObject *args)
+{
+   Sim()->getStatsManager()->requestFullSnapshot();
+
+   Py_RETURN_NONE;
+}
+
+
 //////////
 // register(): register a callback function that returns a statistics value
 //////////
 
 static UInt64 statsCallback(String objectName, UInt32 index, String metricName, UInt64 _pFunc)
 {
+   HooksPy::ScopedInterpreterLock sl;
    PyObject *pFunc = (PyObject*)_pFunc;
    PyObject *pResult = HooksPy::callPythonFunction(pFunc, Py_BuildValue("(sls)", objectName.c_str(), index, metricName.c_str()));
 
@@ -247,6 +261,7 @@ static PyMethodDef PyStatsMethods[] = {
    {"get",  getStatsValue, METH_VARARGS, "Retrieve current value of statistic (objectName, index, metricName)."},
    {"getter", getStatsGetter, METH_VARARGS, "Return object to retrieve statistics value."},
    {"write", writeStats, METH_VARARGS, "Write statistics (<prefix>, [<filename>])."},
+   {"request_full_snapshot", requestFullSnapshot, METH_VARARGS, "Snapshot all statistics at this barrier for pipelined HOOK_PERIODIC observers, allowing them to write statistics."},
    {"register", registerStats, METH_VARARGS, "Register callback that defines statistics value for (objectName, index, metricName)."},
    {"register_per_thread", registerPerThread, METH_VARARGS, "Add a per-thread statistic (perthreadName) based on a named statistic (objectName, metricName)."},
    {"marker", writeMarker, METH_VARARGS, "Record a marker (coreid, threadid, arg0, arg1, [description])."},
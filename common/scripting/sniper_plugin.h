@@ -0,0 +1,46 @@
+#ifndef SNIPER_PLUGIN_H
+#define SNIPER_PLUGIN_H
+
+// Native (C++) plugin interface, a low-overhead alternative to Python hook scripts.
+//
+// A plugin is a shared object (.so) passed to run-sniper using -s <name>[:<args>], it is loaded into the
+// simulator process and has direct access to the simulator's objects (Sim(), HooksManager, StatsManager, ...).
+// It exports a sniper_plugin_init() function which is called once at startup, after configuration
+// and before the simulation starts, and which typically registers hook callbacks:
+//
+//    #include "sniper_plugin.h"
+//
+//    static SInt64 periodic(UInt64 self, UInt64 _time) { ... }
+//
+//    SNIPER_PLUGIN_INIT(args)
+//    {
+//       Sim()->getHooksManager()->registerHook(HookType::HOOK_PERIODIC, periodic, 0);
+//    }
+//
+// An optional sniper_plugin_fini() is called at simulation end, after HOOK_SIM_END.
+//
+// Callbacks are made from the same context as Python hooks: HOOK_PERIODIC is called from the barrier
+// with the thread manager lock held, so simulator functions that expect that lock (e.g. MagicServer::setFrequency)
+// can be called directly. Use StatsManager::getMetricObject() at init time to obtain statistics handles
+// that can be read with StatsMetricBase::recordMetric() without any lookups.
+// Read-only HOOK_PERIODIC observers can register with HooksManager::ORDER_NOTIFY_PIPELINED: with
+// hooks/periodic_pipelined enabled, they run on a service thread without the thread manager lock, and should
+// read statistics through StatsManager::readMetric() to see the snapshot taken at the barrier. Observers that write
+// statistics must have a synchronous HOOK_PERIODIC callback call StatsManager::requestFullSnapshot() at that barrier.
+// See scripts/plugins for examples, and scripts/plugins/Makefile for how to build them.
+
+#include "simulator.h"
+#include "hooks_manager.h"
+#include "stats.h"
+#include "subsecond_time.h"
+
+#define SNIPER_PLUGIN_INIT_SYMBOL "sniper_plugin_init"
+#define SNIPER_PLUGIN_FINI_SYMBOL "sniper_plugin_fini"
+
+typedef void (*SniperPluginInitFunc)(const char *args);
+typedef void (*SniperPluginFiniFunc)(void);
+
+#define SNIPER_PLUGIN_INIT(args) extern "C" void sniper_plugin_init(const char *args)
+#define SNIPER_PLUGIN_FINI() extern "C" void sniper_plugin_fini(void)
+
+#endif // SNIPER_PLUGIN_H
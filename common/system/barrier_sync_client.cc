@@ -19,6 +19,9 @@ BarrierSyncClient::BarrierSyncClient(Core* core):
    {
       LOG_PRINT_ERROR("Error Reading 'clock_skew_minimization/barrier/quantum' from the config file");
    }
+   // The server may have clamped the configured quantum (adaptive quantum), start on its grid
+   if (Sim()->getClockSkewMinimizationServer())
+      m_barrier_interval = Sim()->getClockSkewMinimizationServer()->getBarrierInterval();
    m_next_sync_time = m_barrier_interval;
 }
 
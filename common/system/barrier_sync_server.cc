@@ -4,16 +4,21 @@
 #include "core_manager.h"
 #include "core.h"
 #include "thread.h"
+#include "network.h"
 #include "performance_model.h"
 #include "hooks_manager.h"
 #include "syscall_server.h"
 #include "config.h"
+#include "host_profiler.h"
 #include "log.h"
 #include "stats.h"
 #include "config.hpp"
 #include "circular_log.h"
 
 #include <algorithm>
+#include <sched.h>
+#include <unistd.h>
+#include <sys/syscall.h>
 
 BarrierSyncServer::BarrierSyncServer()
    : m_local_clock_list(Sim()->getConfig()->getApplicationCores(), SubsecondTime::Zero())
@@ -21,7 +26,13 @@ BarrierSyncServer::BarrierSyncServer()
    , m_core_cond(Sim()->getConfig()->getApplicationCores(), NULL)
    , m_core_group(Sim()->getConfig()->getApplicationCores(), INVALID_CORE_ID)
    , m_core_thread(Sim()->getConfig()->getApplicationCores(), INVALID_THREAD_ID)
+   , m_core_siblings(Sim()->getConfig()->getApplicationCores())
+   , m_scan_pos(0)
+   , m_scan_reached(false)
    , m_global_time(SubsecondTime::Zero())
+   , m_interactions(0)
+   , m_remote_packets_last(0)
+   , m_num_barriers(0)
    , m_fastforward(false)
    , m_disable(false)
 {
@@ -34,17 +45,69 @@ BarrierSyncServer::BarrierSyncServer()
       LOG_PRINT_ERROR("Error Reading 'clock_skew_minimization/barrier/quantum' from the config file");
    }
 
+   m_adaptive = Sim()->getCfg()->getBool("clock_skew_minimization/barrier/adaptive");
+   if (m_adaptive)
+   {
+      m_quantum_min = SubsecondTime::NS(Sim()->getCfg()->getInt("clock_skew_minimization/barrier/quantum_min"));
+      m_quantum_max = SubsecondTime::NS(Sim()->getCfg()->getInt("clock_skew_minimization/barrier/quantum_max"));
+      m_adaptive_low = Sim()->getCfg()->getInt("clock_skew_minimization/barrier/adaptive_low");
+      m_adaptive_high = Sim()->getCfg()->getInt("clock_skew_minimization/barrier/adaptive_high");
+      LOG_ASSERT_ERROR(m_quantum_min > SubsecondTime::Zero() && m_quantum_min <= m_quantum_max,
+         "Invalid clock_skew_minimization/barrier/quantum_{min,max}");
+      m_barrier_interval = std::min(std::max(m_barrier_interval, m_quantum_min), m_quantum_max);
+   }
+
    for(core_id_t core_id = 0; core_id < (core_id_t)Sim()->getConfig()->getApplicationCores(); ++core_id)
       m_core_cond[core_id] = new ConditionVariable();
 
+   m_worker_pool = Sim()->getCfg()->getBool("clock_skew_minimization/barrier/worker_pool");
+   m_worker_pin = m_worker_pool && Sim()->getCfg()->getBool("clock_skew_minimization/barrier/worker_pin");
+   m_num_workers = std::max(Sim()->getConfig()->getNumHostCores(), 1U);
+   m_worker_queued = 0;
+   m_worker_queue.resize(m_num_workers);
+   m_worker_busy.resize(m_num_workers, false);
+   m_core_worker.resize(Sim()->getConfig()->getApplicationCores(), -1);
+   m_worker_local = 0;
+   m_worker_steals = 0;
+   if (m_worker_pin)
+   {
+      // Map workers onto the host CPUs we are allowed to run on
+      cpu_set_t mask;
+      CPU_ZERO(&mask);
+      std::vector<int> cpus;
+      if (sched_getaffinity(0, sizeof(mask), &mask) == 0)
+         for(int cpu = 0; cpu < CPU_SETSIZE; ++cpu)
+            if (CPU_ISSET(cpu, &mask))
+               cpus.push_back(cpu);
+      if (cpus.empty())
+      {
+         LOG_PRINT_WARNING("Cannot determine host CPU affinity, disabling clock_skew_minimization/barrier/worker_pin");
+         m_worker_pin = false;
+      }
+      else
+      {
+         for(UInt32 w = 0; w < m_num_workers; ++w)
+            m_worker_cpu.push_back(cpus[w % cpus.size()]);
+      }
+   }
+
    m_next_barrier_time = m_barrier_interval;
 
    // Order our hooks to occur after possible reschedulings (which are done with ORDER_ACTION)
    Sim()->getHooksManager()->registerHook(HookType::HOOK_THREAD_EXIT, BarrierSyncServer::hookThreadExit, (UInt64)this, HooksManager::ORDER_NOTIFY_POST);
    Sim()->getHooksManager()->registerHook(HookType::HOOK_THREAD_STALL, BarrierSyncServer::hookThreadStall, (UInt64)this, HooksManager::ORDER_NOTIFY_POST);
    Sim()->getHooksManager()->registerHook(HookType::HOOK_THREAD_MIGRATE, BarrierSyncServer::hookThreadMigrate, (UInt64)this, HooksManager::ORDER_NOTIFY_POST);
+   Sim()->getHooksManager()->registerHook(HookType::HOOK_THREAD_START, BarrierSyncServer::hookThreadResume, (UInt64)this, HooksManager::ORDER_NOTIFY_POST);
+   Sim()->getHooksManager()->registerHook(HookType::HOOK_THREAD_RESUME, BarrierSyncServer::hookThreadResume, (UInt64)this, HooksManager::ORDER_NOTIFY_POST);
 
    registerStatsMetric("barrier", 0, "global_time", &m_global_time);
+   registerStatsMetric("barrier", 0, "quantum", &m_barrier_interval);
+   registerStatsMetric("barrier", 0, "num_barriers", &m_num_barriers);
+   if (m_worker_pool)
+   {
+      registerStatsMetric("barrier", 0, "worker_local", &m_worker_local);
+      registerStatsMetric("barrier", 0, "worker_steals", &m_worker_steals);
+   }
 }
 
 BarrierSyncServer::~BarrierSyncServer()
@@ -56,6 +119,14 @@ BarrierSyncServer::~BarrierSyncServer()
 void
 BarrierSyncServer::synchronize(core_id_t core_id, SubsecondTime time)
 {
+   HostProfiler::Scoped hp(HostProfiler::BARRIER);
+
+   // Most calls are made well before the next barrier and return immediately: check this before taking the
+   // thread manager lock. A stale m_next_barrier_time can only be too low (it never decreases while cores
+   // are running in detailed mode), in which case we fall through and check again with the lock held.
+   if (m_disable || (time < m_next_barrier_time && !m_fastforward))
+      return;
+
    ScopedLock sl(Sim()->getThreadManager()->getLock());
    if (m_disable)
       return;
@@ -84,20 +155,27 @@ BarrierSyncServer::synchronize(core_id_t core_id, SubsecondTime time)
    }
 
    // One thread entered the barrier, another one can resume
-   doRelease(1);
+   releaseSlot(master_core_id);
 
    master_core->getPerformanceModel()->barrierEnter();
 
    m_local_clock_list[master_core_id] = time;
    m_barrier_acquire_list[master_core_id] = true;
    m_core_thread[master_core_id] = thread_me;
+   if (thread_me >= (thread_id_t)m_thread_core.size())
+      m_thread_core.resize(thread_me + 1, INVALID_CORE_ID);
+   m_thread_core[thread_me] = master_core_id;
 
    bool mustWait = true;
    if (isBarrierReached())
       mustWait = barrierRelease(thread_me);
 
    if (mustWait)
+   {
       m_core_cond[master_core_id]->wait(Sim()->getThreadManager()->getLock());
+      if (m_worker_pin)
+         workerPin(master_core_id, thread_me);
+   }
    else
       master_core->getPerformanceModel()->barrierExit();
 
@@ -107,6 +185,9 @@ BarrierSyncServer::synchronize(core_id_t core_id, SubsecondTime time)
 void
 BarrierSyncServer::threadExit(HooksManager::ThreadTime *argument)
 {
+   // The host thread is gone, its affinity no longer needs restoring
+   if (argument->thread_id < (thread_id_t)m_thread_pinned.size())
+      m_thread_pinned[argument->thread_id] = -1;
    // Release thread from the barrier
    releaseThread(argument->thread_id);
    // Check to see if we were waiting for this thread
@@ -116,6 +197,7 @@ BarrierSyncServer::threadExit(HooksManager::ThreadTime *argument)
 void
 BarrierSyncServer::threadStall(HooksManager::ThreadStall *argument)
 {
+   ++m_interactions;
    // Release thread from the barrier
    releaseThread(argument->thread_id);
    // Check to see if we were waiting for this thread
@@ -131,19 +213,35 @@ BarrierSyncServer::threadMigrate(HooksManager::ThreadMigrate *argument)
    // Migration because of pre-emption is done only inside periodic(), we'll return into barrierRelease()
 }
 
+void
+BarrierSyncServer::threadResume()
+{
+   ++m_interactions;
+   // A core may have started running, and will need to reach the barrier
+   resetScan();
+}
+
 void
 BarrierSyncServer::releaseThread(thread_id_t thread_id)
 {
-   for(core_id_t core_id = 0; core_id < (core_id_t) Sim()->getConfig()->getApplicationCores(); core_id++)
+   core_id_t slot_core_id = INVALID_CORE_ID;
+   if (thread_id < (thread_id_t)m_thread_core.size())
    {
-      if (m_barrier_acquire_list[core_id] && m_core_thread[core_id] == thread_id)
+      core_id_t core_id = m_thread_core[thread_id];
+      if (core_id != INVALID_CORE_ID && m_core_thread[core_id] == thread_id)
       {
-         // Make sure thread is released on next barrierRelease()
-         m_local_clock_list[core_id] = SubsecondTime::Zero();
+         slot_core_id = core_id;
+         if (m_barrier_acquire_list[core_id])
+         {
+            // Make sure thread is released on next barrierRelease()
+            m_local_clock_list[core_id] = SubsecondTime::Zero();
+         }
       }
    }
+   // Running state and/or barrier arrival of some cores has changed
+   resetScan();
    // One thread stopped running, release another one now
-   doRelease(1);
+   releaseSlot(slot_core_id);
 }
 
 void
@@ -170,13 +268,10 @@ BarrierSyncServer::isCoreRunning(core_id_t core_id, bool siblings)
 
    if (siblings && !m_fastforward)
    {
-      for (core_id_t sibling_core_id = 0; sibling_core_id < (core_id_t) Sim()->getConfig()->getApplicationCores(); sibling_core_id++)
+      for (std::vector<core_id_t>::iterator it = m_core_siblings[core_id].begin(); it != m_core_siblings[core_id].end(); ++it)
       {
-         if (m_core_group[sibling_core_id] == core_id)
-         {
-            if (isCoreRunning(sibling_core_id, false))
-               return true;
-         }
+         if (isCoreRunning(*it, false))
+            return true;
       }
    }
 
@@ -192,19 +287,22 @@ BarrierSyncServer::advance()
 bool
 BarrierSyncServer::isBarrierReached()
 {
-   bool single_core_barrier_reached = false;
-
    // Check if all cores have reached the barrier
    // All least one core must have (sync_time > m_next_barrier_time)
-   for (core_id_t core_id = 0; core_id < (core_id_t) Sim()->getConfig()->getApplicationCores(); core_id++)
+   // Continue where the previous check stopped: cores before m_scan_pos have reached the barrier or are not running,
+   // events that can change this (new barrier, thread start/stall/resume/migrate/exit) call resetScan().
+   // This way, each core is visited about once per barrier quantum, rather than all cores on each arrival.
+   for ( ; m_scan_pos < (core_id_t) Sim()->getConfig()->getApplicationCores(); m_scan_pos++)
    {
+      core_id_t core_id = m_scan_pos;
+
       // In fastforward mode, it's enough that a core is waiting. In detailed mode, it needs to have advanced up to the predefined barrier time
       if (m_fastforward)
       {
          if (m_barrier_acquire_list[core_id])
          {
             // At least one core has reached the barrier
-            single_core_barrier_reached = true;
+            m_scan_reached = true;
          }
          else if (isCoreRunning(core_id))
          {
@@ -228,12 +326,12 @@ BarrierSyncServer::isBarrierReached()
          else
          {
             // At least one core has reached the barrier
-            single_core_barrier_reached = true;
+            m_scan_reached = true;
          }
       }
    }
 
-   return single_core_barrier_reached;
+   return m_scan_reached;
 }
 
 bool
@@ -246,7 +344,10 @@ BarrierSyncServer::barrierRelease(thread_id_t caller_id, bool continue_until_rel
    // Advance m_next_barrier_time
    // Release the Barrier
 
-   LOG_ASSERT_ERROR(m_to_release.size() == 0, "Reached the barrier while some threads haven't even restarted?");
+   LOG_ASSERT_ERROR(m_to_release.size() == 0 && m_worker_queued == 0, "Reached the barrier while some threads haven't even restarted?");
+
+   // Barrier time will move, arrival status of all cores needs to be re-evaluated
+   resetScan();
 
    if (m_fastforward)
    {
@@ -264,6 +365,7 @@ BarrierSyncServer::barrierRelease(thread_id_t caller_id, bool continue_until_rel
 
    bool core_resumed = false;
    bool must_wait = true;
+   core_id_t caller_core_id = INVALID_CORE_ID;
    while (!core_resumed)
    {
       m_global_time = m_next_barrier_time;
@@ -283,6 +385,10 @@ BarrierSyncServer::barrierRelease(thread_id_t caller_id, bool continue_until_rel
       if (m_disable)
          return false;
 
+      ++m_num_barriers;
+      if (m_adaptive && !m_fastforward)
+         adaptQuantum();
+
       m_next_barrier_time += m_barrier_interval;
       LOG_PRINT("m_next_barrier_time updated to (%s)", itostr(m_next_barrier_time).c_str());
 
@@ -300,27 +406,76 @@ BarrierSyncServer::barrierRelease(thread_id_t caller_id, bool continue_until_rel
                core_resumed = true;
 
                if (m_core_thread[core_id] == caller_id)
+               {
                   must_wait = false;
+                  caller_core_id = core_id;
+               }
                else
                {
                   Core *core = Sim()->getCoreManager()->getCoreFromID(core_id);
                   core->getPerformanceModel()->barrierExit();
-                  m_to_release.push_back(core_id);
+                  if (useWorkerPool())
+                     workerQueue(core_id);
+                  else
+                     m_to_release.push_back(core_id);
                }
             }
          }
       }
    }
 
-   // To avoid overwhelming the OS scheduler, we only release N threads at a time (N ~= host cores).
-   // Once a thread is done (stops executing because it completed the next barrier quantum, or due to thread stall),
-   // one more thread is released so we always have at most N running threads.
-   std::random_shuffle(m_to_release.begin(), m_to_release.end());
-   doRelease(m_fastforward ? -1 : Sim()->getConfig()->getNumHostCores());
+   if (useWorkerPool())
+   {
+      // The calling thread continues running, so it occupies a worker too
+      if (!must_wait)
+         workerAcquire(caller_core_id);
+      workerSchedule();
+   }
+   else
+   {
+      // Fast-forward may have been enabled from HOOK_PERIODIC after cores were queued on workers
+      workerFlush();
+
+      // To avoid overwhelming the OS scheduler, we only release N threads at a time (N ~= host cores).
+      // Once a thread is done (stops executing because it completed the next barrier quantum, or due to thread stall),
+      // one more thread is released so we always have at most N running threads.
+      std::random_shuffle(m_to_release.begin(), m_to_release.end());
+      doRelease(m_fastforward ? -1 : Sim()->getConfig()->getNumHostCores());
+   }
+
+   // New barrier quantum
+   resetScan();
 
    return must_wait;
 }
 
+void
+BarrierSyncServer::adaptQuantum()
+{
+   // Inter-core interaction during the last quantum: messages between cores (coherence traffic) and thread stalls/wakeups (synchronization)
+   UInt64 remote_packets = 0;
+   for (core_id_t core_id = 0; core_id < (core_id_t) Sim()->getConfig()->getApplicationCores(); core_id++)
+      remote_packets += Sim()->getCoreManager()->getCoreFromID(core_id)->getNetwork()->getRemotePacketCount();
+   UInt64 interactions = (remote_packets - m_remote_packets_last) + m_interactions;
+   m_remote_packets_last = remote_packets;
+   m_interactions = 0;
+
+   // Normalize to interactions per 100 ns
+   UInt64 rate = interactions * 100 / std::max(m_barrier_interval.getNS(), UInt64(1));
+   SubsecondTime interval = m_barrier_interval;
+   if (rate < m_adaptive_low)
+      interval = std::min(m_barrier_interval * 2, m_quantum_max);
+   else if (rate > m_adaptive_high)
+      interval = std::max(m_barrier_interval / 2, m_quantum_min);
+
+   // Clients place their next synchronization at the next multiple of the interval, so only switch at a barrier
+   // that is a multiple of the new interval. Otherwise the next barrier (m_next_barrier_time + interval) would not
+   // be on the clients' grid, and cores would run up to a full quantum past it. While the interaction rate
+   // stays out of bounds, the change is made at the first aligned barrier.
+   if (interval != m_barrier_interval && m_next_barrier_time.getFS() % interval.getFS() == 0)
+      m_barrier_interval = interval;
+}
+
 void
 BarrierSyncServer::doRelease(int n)
 {
@@ -334,10 +489,148 @@ BarrierSyncServer::doRelease(int n)
    }
 }
 
+void
+BarrierSyncServer::releaseSlot(core_id_t core_id)
+{
+   if (useWorkerPool())
+   {
+      // Free the worker held by this core (if any), and give idle workers a new core to run
+      if (core_id != INVALID_CORE_ID && m_core_worker[core_id] != -1)
+      {
+         m_worker_busy[m_core_worker[core_id]] = false;
+         m_core_worker[core_id] = -1;
+      }
+      workerSchedule();
+   }
+   else
+      doRelease(1);
+}
+
+void
+BarrierSyncServer::workerQueue(core_id_t core_id)
+{
+   // Cores have a fixed home worker, so consecutive quanta of a core tend to run on the same host CPU
+   m_worker_queue[core_id % m_num_workers].push_back(core_id);
+   ++m_worker_queued;
+}
+
+bool
+BarrierSyncServer::workerAcquire(core_id_t core_id)
+{
+   UInt32 worker = core_id % m_num_workers;
+   if (m_worker_busy[worker])
+   {
+      worker = std::find(m_worker_busy.begin(), m_worker_busy.end(), false) - m_worker_busy.begin();
+      if (worker == m_num_workers)
+         return false;
+   }
+   m_worker_busy[worker] = true;
+   m_core_worker[core_id] = worker;
+   return true;
+}
+
+void
+BarrierSyncServer::workerSchedule()
+{
+   for(UInt32 worker = 0; worker < m_num_workers && m_worker_queued; ++worker)
+   {
+      if (m_worker_busy[worker])
+         continue;
+
+      core_id_t core_id;
+      if (!m_worker_queue[worker].empty())
+      {
+         core_id = m_worker_queue[worker].front();
+         m_worker_queue[worker].pop_front();
+         ++m_worker_local;
+      }
+      else
+      {
+         // Steal from the opposite end of the longest deque
+         UInt32 victim = 0;
+         for(UInt32 w = 1; w < m_num_workers; ++w)
+            if (m_worker_queue[w].size() > m_worker_queue[victim].size())
+               victim = w;
+         core_id = m_worker_queue[victim].back();
+         m_worker_queue[victim].pop_back();
+         ++m_worker_steals;
+      }
+      --m_worker_queued;
+
+      m_worker_busy[worker] = true;
+      m_core_worker[core_id] = worker;
+      m_core_cond[core_id]->signal();
+   }
+}
+
+void
+BarrierSyncServer::workerFlush()
+{
+   // Release all queued cores at once and forget about worker ownership
+   for(UInt32 worker = 0; worker < m_num_workers; ++worker)
+   {
+      for(std::deque<core_id_t>::iterator it = m_worker_queue[worker].begin(); it != m_worker_queue[worker].end(); ++it)
+         m_core_cond[*it]->signal();
+      m_worker_queue[worker].clear();
+      m_worker_busy[worker] = false;
+   }
+   m_worker_queued = 0;
+   std::fill(m_core_worker.begin(), m_core_worker.end(), -1);
+   // Threads released outside of the pool may run anywhere again
+   workerUnpin();
+}
+
+void
+BarrierSyncServer::workerPin(core_id_t core_id, thread_id_t thread_id)
+{
+   // Called by the released thread itself: move it onto the host CPU of the worker it was scheduled on
+   SInt32 worker = m_core_worker[core_id];
+   if (worker == -1)
+      return;
+   if (thread_id >= (thread_id_t)m_thread_pinned.size())
+   {
+      m_thread_pinned.resize(thread_id + 1, -1);
+      m_thread_tid.resize(thread_id + 1, 0);
+      m_thread_affinity.resize(thread_id + 1);
+   }
+   if (m_thread_pinned[thread_id] == worker)
+      return;
+
+   if (m_thread_pinned[thread_id] == -1)
+   {
+      // First pin since the last restore: remember where this thread was allowed to run
+      m_thread_tid[thread_id] = syscall(SYS_gettid);
+      if (sched_getaffinity(0, sizeof(cpu_set_t), &m_thread_affinity[thread_id]) != 0)
+         return;
+   }
+
+   cpu_set_t mask;
+   CPU_ZERO(&mask);
+   CPU_SET(m_worker_cpu[worker], &mask);
+   if (sched_setaffinity(0, sizeof(mask), &mask) == 0)
+      m_thread_pinned[thread_id] = worker;
+}
+
+void
+BarrierSyncServer::workerUnpin()
+{
+   // Give all pinned threads back their original affinity. Called from whichever thread flushes the pool,
+   // so address the pinned threads by their host thread id.
+   for(thread_id_t thread_id = 0; thread_id < (thread_id_t)m_thread_pinned.size(); ++thread_id)
+   {
+      if (m_thread_pinned[thread_id] == -1)
+         continue;
+      sched_setaffinity(m_thread_tid[thread_id], sizeof(cpu_set_t), &m_thread_affinity[thread_id]);
+      m_thread_pinned[thread_id] = -1;
+   }
+}
+
 void
 BarrierSyncServer::abortBarrier()
 {
    CLOG("barrier", "Abort");
+   resetScan();
+   workerFlush();
    for(core_id_t core_id = 0; core_id < (core_id_t) Sim()->getConfig()->getApplicationCores(); core_id++)
    {
       // Check if this core was running. If yes, release that core
@@ -356,6 +649,7 @@ void
 BarrierSyncServer::setDisable(bool disable)
 {
    this->m_disable = disable;
+   resetScan();
    if (disable)
       abortBarrier();
 }
@@ -366,7 +660,16 @@ BarrierSyncServer::setGroup(core_id_t core_id, core_id_t master_core_id)
    if (master_core_id != INVALID_CORE_ID)
       LOG_ASSERT_ERROR(m_barrier_acquire_list[core_id] == false, "Core(%d) is in the barrier, cannot set participate to false", core_id);
 
+   if (m_core_group[core_id] != INVALID_CORE_ID)
+   {
+      std::vector<core_id_t> &siblings = m_core_siblings[m_core_group[core_id]];
+      siblings.erase(std::remove(siblings.begin(), siblings.end(), core_id), siblings.end());
+   }
+   if (master_core_id != INVALID_CORE_ID)
+      m_core_siblings[master_core_id].push_back(core_id);
+
    m_core_group[core_id] = master_core_id;
+   resetScan();
 }
 
 void
@@ -375,6 +678,9 @@ BarrierSyncServer::setFastForward(bool fastforward, SubsecondTime next_barrier_t
    if (m_fastforward != fastforward)
       CLOG("barrier", "FastForward %d > %d", m_fastforward, fastforward);
    m_fastforward = fastforward;
+   resetScan();
+   if (fastforward)
+      workerFlush();
    if (next_barrier_time != SubsecondTime::MaxTime())
    {
       m_next_barrier_time = std::max(m_next_barrier_time, next_barrier_time);
@@ -6,6 +6,8 @@
 #include "hooks_manager.h"
 
 #include <vector>
+#include <deque>
+#include <sched.h>
 
 class CoreManager;
 
@@ -20,17 +22,54 @@ class BarrierSyncServer : public ClockSkewMinimizationServer
       std::vector<core_id_t> m_to_release;
       std::vector<core_id_t> m_core_group;
       std::vector<thread_id_t> m_core_thread;
+      std::vector<std::vector<core_id_t> > m_core_siblings; // For each group master, the cores that have it as master
+      std::vector<core_id_t> m_thread_core;                 // For each thread, the (master) core on which it last entered the barrier
+      // Incremental barrier check: cores below m_scan_pos are known to either have reached the barrier or not be running,
+      // m_scan_reached is set when at least one of them has reached the barrier
+      core_id_t m_scan_pos;
+      bool m_scan_reached;
       SubsecondTime m_global_time;
+      // Adaptive quantum: widen the barrier interval while cores rarely interact, shrink it when they do
+      bool m_adaptive;
+      SubsecondTime m_quantum_min, m_quantum_max;
+      UInt64 m_adaptive_low, m_adaptive_high;   // Thresholds, in interactions per 100 ns
+      UInt64 m_interactions;                    // Thread stalls/wakeups during the current quantum
+      UInt64 m_remote_packets_last;
+      UInt64 m_num_barriers;
+      // Worker pool: at most m_num_workers released cores run at any time, each holding a worker slot.
+      // Released cores are queued on their home worker's deque; a worker that becomes idle takes the next core
+      // from its own deque, or steals from the back of the longest other deque.
+      bool m_worker_pool;
+      bool m_worker_pin;
+      UInt32 m_num_workers;
+      UInt32 m_worker_queued;
+      std::vector<std::deque<core_id_t> > m_worker_queue;
+      std::vector<bool> m_worker_busy;
+      std::vector<int> m_worker_cpu;            // Host CPU for each worker (when pinning)
+      std::vector<SInt32> m_core_worker;        // Worker slot held by each (master) core, -1 if none
+      std::vector<SInt32> m_thread_pinned;      // Worker to whose host CPU each thread was last pinned, -1 if none
+      std::vector<pid_t> m_thread_tid;          // Host thread id of each pinned thread
+      std::vector<cpu_set_t> m_thread_affinity; // Affinity of each pinned thread before its first pin, restored by workerUnpin
+      UInt64 m_worker_local, m_worker_steals;
       bool m_fastforward;
       volatile bool m_disable;
 
       bool isBarrierReached(void);
+      void resetScan(void) { m_scan_pos = 0; m_scan_reached = false; }
       bool barrierRelease(thread_id_t thread_id = INVALID_THREAD_ID, bool continue_until_release = false);
       void abortBarrier(void);
       bool isCoreRunning(core_id_t core_id, bool siblings = true);
       void releaseThread(thread_id_t thread_id);
       void signal();
       void doRelease(int n);
+      bool useWorkerPool() const { return m_worker_pool && !m_fastforward; }
+      void releaseSlot(core_id_t core_id);
+      void workerQueue(core_id_t core_id);
+      bool workerAcquire(core_id_t core_id);
+      void workerSchedule(void);
+      void workerFlush(void);
+      void workerPin(core_id_t core_id, thread_id_t thread_id);
+      void workerUnpin(void);
 
       static SInt64 hookThreadExit(UInt64 object, UInt64 argument) {
          ((BarrierSyncServer*)object)->threadExit((HooksManager::ThreadTime*)argument); return 0;
@@ -41,9 +80,14 @@ class BarrierSyncServer : public ClockSkewMinimizationServer
       static SInt64 hookThreadMigrate(UInt64 object, UInt64 argument) {
          ((BarrierSyncServer*)object)->threadMigrate((HooksManager::ThreadMigrate*)argument); return 0;
       }
+      static SInt64 hookThreadResume(UInt64 object, UInt64 argument) {
+         ((BarrierSyncServer*)object)->threadResume(); return 0;
+      }
       void threadExit(HooksManager::ThreadTime *argument);
       void threadStall(HooksManager::ThreadStall *argument);
       void threadMigrate(HooksManager::ThreadMigrate *argument);
+      void threadResume();
+      void adaptQuantum();
 
    public:
       BarrierSyncServer();
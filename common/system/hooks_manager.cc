@@ -1,5 +1,9 @@
 #include "hooks_manager.h"
 #include "log.h"
+#include "host_profiler.h"
+#include "host_perf_counters.h"
+#include "simulator.h"
+#include "stats.h"
 
 const char* HookType::hook_type_names[] = {
    "HOOK_PERIODIC",
@@ -32,28 +36,183 @@ static_assert(HookType::HOOK_TYPES_MAX == sizeof(HookType::hook_type_names) / si
               "Not enough values in HookType::hook_type_names");
 
 HooksManager::HooksManager()
+   : m_pipelined(NULL)
 {
+   for(int type = 0; type < HookType::HOOK_TYPES_MAX; ++type)
+      m_dispatching[type] = 0;
 }
 
 void HooksManager::registerHook(HookType::hook_type_t type, HookCallbackFunc func, UInt64 argument, HookCallbackOrder order)
 {
-   m_registry[type].push_back(HookCallback(func, argument, order));
+   // Inserting into the list while it is being walked would run callbacks twice or skip them.
+   // With pipelined HOOK_PERIODIC, the service thread may be walking that list at any time.
+   if (m_dispatching[type] || (type == HookType::HOOK_PERIODIC && m_pipelined))
+      m_pending[type].push_back(HookCallback(func, argument, order));
+   else
+      insertHook(type, HookCallback(func, argument, order));
+}
+
+void HooksManager::insertHook(HookType::hook_type_t type, const HookCallback &callback)
+{
+   std::vector<HookCallback> &callbacks = m_registry[type];
+   // Insert after all callbacks with the same or an earlier order
+   std::vector<HookCallback>::iterator it = callbacks.begin();
+   while(it != callbacks.end() && it->order <= callback.order)
+      ++it;
+   callbacks.insert(it, callback);
+}
+
+void HooksManager::mergePending(HookType::hook_type_t type)
+{
+   for(std::vector<HookCallback>::iterator it = m_pending[type].begin(); it != m_pending[type].end(); ++it)
+      insertHook(type, *it);
+   m_pending[type].clear();
 }
 
 SInt64 HooksManager::callHooks(HookType::hook_type_t type, UInt64 arg, bool expect_return)
 {
-   for(unsigned int order = 0; order < NUM_HOOK_ORDER; ++order)
+   if (m_registry[type].empty() && m_pending[type].empty())
+      return -1;
+
+   HostProfiler::Scoped hp(HostProfiler::HOOKS);
+   if (type == HookType::HOOK_PERIODIC && m_pipelined)
+      return callPeriodicPipelined(arg);
+
+   // Callbacks registered during the previous dispatch run from this one on
+   if (m_dispatching[type] == 0 && !m_pending[type].empty())
+      mergePending(type);
+
+   ++m_dispatching[type];
+   SInt64 result = -1;
+   std::vector<HookCallback> &callbacks = m_registry[type];
+   for(unsigned int idx = 0; idx < callbacks.size(); ++idx)
+   {
+      SInt64 ret = callbacks[idx].func(callbacks[idx].arg, arg);
+      if (expect_return && ret != -1)
+      {
+         result = ret;
+         break;
+      }
+   }
+   --m_dispatching[type];
+
+   return result;
+}
+
+SInt64 HooksManager::callPeriodicPipelined(UInt64 arg)
+{
+   // Observers from the previous barrier may still be looking at their snapshot, and callbacks
+   // below could change what they see (or register new hooks): let them finish first
+   m_pipelined->drain();
+   // The service thread is idle, so callbacks registered since the last barrier can be added now
+   mergePending(HookType::HOOK_PERIODIC);
+
+   std::vector<HookCallback> &callbacks = m_registry[HookType::HOOK_PERIODIC];
+   bool have_pipelined = false;
+   for(unsigned int idx = 0; idx < callbacks.size(); ++idx)
    {
-      for(std::vector<HookCallback>::iterator it = m_registry[type].begin(); it != m_registry[type].end(); ++it)
+      // ORDER_NOTIFY_PIPELINED sorts last, so everything before it is run synchronously at the barrier
+      if (callbacks[idx].order == ORDER_NOTIFY_PIPELINED)
       {
-         if (it->order == (HookCallbackOrder)order)
-         {
-            SInt64 result = it->func(it->arg, arg);
-            if (expect_return && result != -1)
-               return result;
-         }
+         have_pipelined = true;
+         break;
       }
+      callbacks[idx].func(callbacks[idx].arg, arg);
+   }
+
+   if (have_pipelined)
+   {
+      // All threads are waiting on the barrier, so this is a consistent view of the statistics
+      // (this also runs HOOK_PRE_STAT_WRITE if a full snapshot was requested by the callbacks above)
+      Sim()->getStatsManager()->takeSnapshot();
+      m_pipelined->start(arg);
    }
 
    return -1;
 }
+
+void HooksManager::callPipelinedObservers(UInt64 arg)
+{
+   HostProfiler::Scoped hp(HostProfiler::HOOKS);
+   Sim()->getStatsManager()->setSnapshotReader(true);
+
+   std::vector<HookCallback> &callbacks = m_registry[HookType::HOOK_PERIODIC];
+   for(unsigned int idx = 0; idx < callbacks.size(); ++idx)
+      if (callbacks[idx].order == ORDER_NOTIFY_PIPELINED)
+         callbacks[idx].func(callbacks[idx].arg, arg);
+
+   Sim()->getStatsManager()->setSnapshotReader(false);
+}
+
+void HooksManager::drainPipelined()
+{
+   if (m_pipelined)
+      m_pipelined->drain();
+}
+
+HooksManager::PipelinedPeriodic::PipelinedPeriodic(HooksManager *hooks_manager)
+   : m_hooks_manager(hooks_manager)
+   , m_thread(NULL)
+   , m_busy(false)
+   , m_quit(false)
+   , m_exited(false)
+   , m_arg(0)
+{
+   m_thread = _Thread::create(this);
+   m_thread->run();
+}
+
+HooksManager::PipelinedPeriodic::~PipelinedPeriodic()
+{
+   {
+      ScopedLock sl(m_lock);
+      while (m_busy)
+         m_cond_done.wait(m_lock);
+      m_quit = true;
+      m_cond_work.signal();
+      while (!m_exited)
+         m_cond_done.wait(m_lock);
+   }
+   delete m_thread;
+}
+
+void HooksManager::PipelinedPeriodic::start(UInt64 arg)
+{
+   ScopedLock sl(m_lock);
+   LOG_ASSERT_ERROR(!m_busy, "Pipelined HOOK_PERIODIC observers started while the previous batch is still running");
+   m_arg = arg;
+   m_busy = true;
+   m_cond_work.signal();
+}
+
+void HooksManager::PipelinedPeriodic::drain()
+{
+   ScopedLock sl(m_lock);
+   while (m_busy)
+      m_cond_done.wait(m_lock);
+}
+
+void HooksManager::PipelinedPeriodic::run()
+{
+   HostPerfCounters::registerThread("hooks-pipelined");
+
+   ScopedLock sl(m_lock);
+   while (true)
+   {
+      while (!m_busy && !m_quit)
+         m_cond_work.wait(m_lock);
+      if (!m_busy)
+         break;
+
+      UInt64 arg = m_arg;
+      m_lock.release();
+      m_hooks_manager->callPipelinedObservers(arg);
+      m_lock.acquire();
+
+      m_busy = false;
+      m_cond_done.broadcast();
+   }
+
+   m_exited = true;
+   m_cond_done.broadcast();
+}
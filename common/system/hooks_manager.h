@@ -4,9 +4,11 @@
 #include "fixed_types.h"
 #include "subsecond_time.h"
 #include "thread_manager.h"
+#include "_thread.h"
+#include "lock.h"
+#include "cond.h"
 
 #include <vector>
-#include <unordered_map>
 
 class HookType
 {
@@ -43,16 +45,6 @@ public:
    static const char* hook_type_names[];
 };
 
-namespace std
-{
-   template <> struct hash<HookType::hook_type_t> {
-      size_t operator()(const HookType::hook_type_t & type) const {
-         //return std::hash<int>(type);
-         return (int)type;
-      }
-   };
-}
-
 class HooksManager
 {
 public:
@@ -60,6 +52,7 @@ public:
       ORDER_NOTIFY_PRE,       // For callbacks that want to inspect state before any actions
       ORDER_ACTION,           // For callbacks that want to change simulator state based on the event
       ORDER_NOTIFY_POST,      // For callbacks that want to inspect state after any actions
+      ORDER_NOTIFY_PIPELINED, // For read-only HOOK_PERIODIC observers that may run on a service thread (see hooks/periodic_pipelined)
       NUM_HOOK_ORDER,
    };
 
@@ -99,9 +92,47 @@ public:
    void fini();
    void registerHook(HookType::hook_type_t type, HookCallbackFunc func, UInt64 argument, HookCallbackOrder order = ORDER_NOTIFY_PRE);
    SInt64 callHooks(HookType::hook_type_t type, UInt64 argument, bool expect_return = false);
+   // Cheap check for hot paths: skip preparing the callback argument (or taking locks) when nobody is listening
+   bool hasHooks(HookType::hook_type_t type) const { return !m_registry[type].empty() || !m_pending[type].empty(); }
+   // Wait until the pipelined HOOK_PERIODIC observers started at the last barrier have completed
+   void drainPipelined();
 
 private:
-   std::unordered_map<HookType::hook_type_t, std::vector<HookCallback> > m_registry;
+   // Pipelined HOOK_PERIODIC: ORDER_NOTIFY_PIPELINED callbacks run on this service thread against a statistics snapshot,
+   // overlapping with the next quantum. At most one batch is outstanding: the next barrier waits for it to complete.
+   // Observers must therefore not change simulator state, register hooks, or take the thread manager lock. To write
+   // statistics, a synchronous callback has to call StatsManager::requestFullSnapshot() at the same barrier.
+   class PipelinedPeriodic : public Runnable
+   {
+      public:
+         PipelinedPeriodic(HooksManager *hooks_manager);
+         ~PipelinedPeriodic();
+         void start(UInt64 arg);
+         void drain();
+      private:
+         void run();
+         HooksManager *m_hooks_manager;
+         _Thread *m_thread;
+         Lock m_lock;
+         ConditionVariable m_cond_work;
+         ConditionVariable m_cond_done;
+         bool m_busy;
+         bool m_quit;
+         bool m_exited;
+         UInt64 m_arg;
+   };
+
+   // Per hook type, callbacks are kept sorted by HookCallbackOrder (and by registration order within each order)
+   std::vector<HookCallback> m_registry[HookType::HOOK_TYPES_MAX];
+   // Callbacks registered while their type is being dispatched, added before the next dispatch
+   std::vector<HookCallback> m_pending[HookType::HOOK_TYPES_MAX];
+   UInt32 m_dispatching[HookType::HOOK_TYPES_MAX];
+   PipelinedPeriodic *m_pipelined;
+
+   void insertHook(HookType::hook_type_t type, const HookCallback &callback);
+   void mergePending(HookType::hook_type_t type);
+   SInt64 callPeriodicPipelined(UInt64 arg);
+   void callPipelinedObservers(UInt64 arg);
 };
 
 #endif /* __HOOKS_MANAGER_H */
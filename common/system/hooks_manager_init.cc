@@ -1,12 +1,14 @@
 #include "hooks_manager.h"
 
 #include "hooks_py.h"
+#include "hooks_native.h"
 
 #include "subsecond_time.h"
 #include "fixed_point.h"
 #include "simulator.h"
 #include "stats.h"
 #include "dvfs_manager.h"
+#include "config.hpp"
 
 
 // Example live-analysis code: print out the IPC for core 0
@@ -44,10 +46,20 @@ void hook_print_core0_ipc(void*, subsecond_time_t _time)
 void HooksManager::init(void)
 {
    HooksPy::init();
+   HooksNative::init();
+
+   if (Sim()->getCfg()->getBool("hooks/periodic_pipelined"))
+      m_pipelined = new PipelinedPeriodic(this);
    //registerHook(HookType::HOOK_PERIODIC, (HookCallbackFunc)hook_print_core0_ipc, NULL);
 }
 
 void HooksManager::fini(void)
 {
+   if (m_pipelined)
+   {
+      delete m_pipelined;
+      m_pipelined = NULL;
+   }
+   HooksNative::fini();
    HooksPy::fini();
 }
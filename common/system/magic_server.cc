@@ -22,6 +22,11 @@ MagicServer::~MagicServer()
 
 UInt64 MagicServer::Magic(thread_id_t thread_id, core_id_t core_id, UInt64 cmd, UInt64 arg0, UInt64 arg1)
 {
+   // Frequency queries are frequent (e.g. from spin loops calibrating their delays) and only read
+   // the current period of a DVFS domain, which is a single word that can be read without locking
+   if (cmd == SIM_CMD_MHZ_GET)
+      return getFrequency(arg0);
+
    ScopedLock sl(Sim()->getThreadManager()->getLock());
 
    return Magic_unlocked(thread_id, core_id, cmd, arg0, arg1);
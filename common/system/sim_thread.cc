@@ -5,6 +5,7 @@
 #include "core.h"
 #include "sim_thread_manager.h"
 #include "sim_api.h"
+#include "host_perf_counters.h"
 
 SimThread::SimThread()
    : m_thread(NULL)
@@ -23,6 +24,7 @@ void SimThread::run()
    // Set thread name for Sniper-in-Sniper simulations
    String threadName = String("sim-") + itostr(core_id);
    SimSetThreadName(threadName.c_str());
+   HostPerfCounters::registerThread(threadName);
 
    LOG_PRINT("Sim thread starting...");
 
@@ -27,6 +27,8 @@
 #include "instruction_tracer.h"
 #include "memory_tracker.h"
 #include "circular_log.h"
+#include "host_profiler.h"
+#include "host_perf_counters.h"
 
 #include <sstream>
 
@@ -100,6 +102,9 @@ void Simulator::start()
    m_fastforward_performance_manager = FastForwardPerformanceManager::create();
    m_rtn_tracer = RoutineTracer::create();
 
+   HostProfiler::init();
+   HostPerfCounters::init();
+
    if (Sim()->getCfg()->getBool("traceinput/enabled"))
       m_trace_manager = new TraceManager();
    else
@@ -162,10 +167,15 @@ Simulator::~Simulator()
       getMagicServer()->setPerformance(false);
    }
 
+   // Let pipelined HOOK_PERIODIC observers finish with the last barrier before writing the final statistics
+   m_hooks_manager->drainPipelined();
+
    m_stats_manager->recordStats("stop");
    m_hooks_manager->callHooks(HookType::HOOK_SIM_END, 0);
 
    TotalTimer::reports();
+   HostProfiler::fini();
+   HostPerfCounters::fini();
 
    LOG_PRINT("Simulator dtor starting...");
 
@@ -0,0 +1,334 @@
+#include "slack_sync_server.h"
+#include "simulator.h"
+#include "core_manager.h"
+#include "core.h"
+#include "thread.h"
+#include "thread_manager.h"
+#include "performance_model.h"
+#include "syscall_server.h"
+#include "config.h"
+#include "config.hpp"
+#include "host_profiler.h"
+#include "timer.h"
+#include "log.h"
+#include "stats.h"
+#include "circular_log.h"
+
+#include <algorithm>
+#include <stdlib.h>
+
+SlackSyncServer::SlackSyncServer()
+   : m_next_periodic(SubsecondTime::Zero())
+   , m_global_time(SubsecondTime::Zero())
+   , m_core_clock((CoreClock*)aligned_alloc(sizeof(CoreClock), Sim()->getConfig()->getApplicationCores() * sizeof(CoreClock)))
+   , m_minimum(SubsecondTime::MaxTime().getFS())
+   , m_core_stats(Sim()->getConfig()->getApplicationCores())
+   , m_core_cond(Sim()->getConfig()->getApplicationCores(), NULL)
+   , m_core_waiting(Sim()->getConfig()->getApplicationCores(), false)
+   , m_core_group(Sim()->getConfig()->getApplicationCores(), INVALID_CORE_ID)
+   , m_num_waiting(0)
+   , m_release_count(0)
+   , m_num_periodic(0)
+   , m_in_periodic(false)
+   , m_fastforward(false)
+   , m_disable(false)
+{
+   m_interval = SubsecondTime::NS(Sim()->getCfg()->getInt("clock_skew_minimization/barrier/quantum"));
+   m_periodic_interval = SubsecondTime::NS(Sim()->getCfg()->getInt("clock_skew_minimization/slack/periodic"));
+   m_slack = SubsecondTime::NS(Sim()->getCfg()->getInt("clock_skew_minimization/slack/slack"));
+   LOG_ASSERT_ERROR(m_interval > SubsecondTime::Zero(), "clock_skew_minimization/barrier/quantum must be larger than zero");
+   LOG_ASSERT_ERROR(m_periodic_interval >= m_interval, "clock_skew_minimization/slack/periodic must be at least clock_skew_minimization/barrier/quantum");
+
+   for(core_id_t core_id = 0; core_id < (core_id_t)Sim()->getConfig()->getApplicationCores(); ++core_id)
+   {
+      setClock(core_id, SubsecondTime::MaxTime());
+      m_core_cond[core_id] = new ConditionVariable();
+
+      CoreStats &stats = m_core_stats[core_id];
+      stats.num_syncs = stats.num_stalls = stats.stall_host_time = 0;
+      stats.skew_max = stats.skew_total = SubsecondTime::Zero();
+      registerStatsMetric("slack", core_id, "num_syncs", &stats.num_syncs);
+      registerStatsMetric("slack", core_id, "num_stalls", &stats.num_stalls);
+      registerStatsMetric("slack", core_id, "stall_host_time", &stats.stall_host_time);
+      registerStatsMetric("slack", core_id, "skew_max", &stats.skew_max);
+      registerStatsMetric("slack", core_id, "skew_total", &stats.skew_total);
+   }
+
+   m_next_periodic = m_periodic_interval;
+
+   // Keep the same statistics as the barrier, for scripts that track simulation progress
+   registerStatsMetric("barrier", 0, "global_time", &m_global_time);
+   registerStatsMetric("barrier", 0, "quantum", &m_interval);
+   registerStatsMetric("barrier", 0, "num_barriers", &m_num_periodic);
+
+   // Order our hooks to occur after possible reschedulings (which are done with ORDER_ACTION)
+   Sim()->getHooksManager()->registerHook(HookType::HOOK_THREAD_START, SlackSyncServer::hookThreadChange, (UInt64)this, HooksManager::ORDER_NOTIFY_POST);
+   Sim()->getHooksManager()->registerHook(HookType::HOOK_THREAD_EXIT, SlackSyncServer::hookThreadChange, (UInt64)this, HooksManager::ORDER_NOTIFY_POST);
+   Sim()->getHooksManager()->registerHook(HookType::HOOK_THREAD_STALL, SlackSyncServer::hookThreadChange, (UInt64)this, HooksManager::ORDER_NOTIFY_POST);
+   Sim()->getHooksManager()->registerHook(HookType::HOOK_THREAD_RESUME, SlackSyncServer::hookThreadChange, (UInt64)this, HooksManager::ORDER_NOTIFY_POST);
+   Sim()->getHooksManager()->registerHook(HookType::HOOK_THREAD_MIGRATE, SlackSyncServer::hookThreadChange, (UInt64)this, HooksManager::ORDER_NOTIFY_POST);
+}
+
+SlackSyncServer::~SlackSyncServer()
+{
+   for(core_id_t core_id = 0; core_id < (core_id_t)Sim()->getConfig()->getApplicationCores(); ++core_id)
+      delete m_core_cond[core_id];
+   free(m_core_clock);
+}
+
+void
+SlackSyncServer::synchronize(core_id_t core_id, SubsecondTime time)
+{
+   if (m_disable)
+      return;
+
+   HostProfiler::Scoped hp(HostProfiler::BARRIER);
+
+   core_id_t master_core_id = getMaster(core_id);
+   CoreStats &stats = m_core_stats[master_core_id];
+
+   // Publish our clock without taking any locks
+   SubsecondTime time_prev = getClock(master_core_id);
+   setClock(master_core_id, time);
+   // Pairs with the barrier after incrementing m_num_waiting: either we see the waiter, or the waiter sees our new clock
+   __sync_synchronize();
+
+   // Only a core that was at the minimum can have moved it: rescan, everyone else uses the cached value
+   UInt64 minimum_cached = m_minimum;
+   bool was_minimum = time_prev.getFS() <= minimum_cached;
+   SubsecondTime minimum = SubsecondTime::FS(minimum_cached);
+   if (was_minimum)
+   {
+      minimum = getMinimum();
+      // Don't overwrite a newer value: refreshRunning() may have lowered the minimum for a core that just (re)started
+      __sync_bool_compare_and_swap(&m_minimum, minimum_cached, minimum.getFS());
+   }
+
+   ++stats.num_syncs;
+   if (time > minimum)
+   {
+      stats.skew_max = std::max(stats.skew_max, time - minimum);
+      stats.skew_total += time - minimum;
+   }
+
+   // Fast path: before the next periodic boundary, not too far ahead, and no one is waiting for the minimum to move
+   if (!isAhead(time, minimum) && (m_num_waiting == 0 || !was_minimum))
+      return;
+
+   ScopedLock sl(Sim()->getThreadManager()->getLock());
+
+   CLOG("slack", "Core %d sync at %" PRId64 "ns", master_core_id, time.getNS());
+
+   periodic();
+   wakeWaiters();
+
+   UInt64 release_count = m_release_count;
+   Timer t_stall;
+   bool stalled = false;
+   while (!m_disable && release_count == m_release_count)
+   {
+      m_core_waiting[master_core_id] = true;
+      ++m_num_waiting;
+      __sync_synchronize();
+      if (!isAhead(time, updateMinimum()))
+      {
+         --m_num_waiting;
+         m_core_waiting[master_core_id] = false;
+         break;
+      }
+      if (!stalled)
+      {
+         stalled = true;
+         ++stats.num_stalls;
+      }
+      m_core_cond[master_core_id]->wait(Sim()->getThreadManager()->getLock());
+      --m_num_waiting;
+      m_core_waiting[master_core_id] = false;
+
+      // The minimum may have moved past a periodic boundary while we were waiting
+      periodic();
+   }
+   if (stalled)
+      stats.stall_host_time += t_stall.getTime();
+}
+
+SubsecondTime
+SlackSyncServer::getMinimum() const
+{
+   UInt64 minimum = SubsecondTime::MaxTime().getFS();
+   for (core_id_t core_id = 0; core_id < (core_id_t) Sim()->getConfig()->getApplicationCores(); core_id++)
+      minimum = std::min(minimum, UInt64(m_core_clock[core_id].time));
+   return SubsecondTime::FS(minimum);
+}
+
+SubsecondTime
+SlackSyncServer::updateMinimum()
+{
+   // Called with the thread manager lock held
+   SubsecondTime minimum = getMinimum();
+   m_minimum = minimum.getFS();
+   return minimum;
+}
+
+bool
+SlackSyncServer::isCoreRunning(core_id_t core_id, bool siblings)
+{
+   Core *core = Sim()->getCoreManager()->getCoreFromID(core_id);
+   if (core->getState() == Core::RUNNING && core->getThread() && Sim()->getThreadManager()->isThreadRunning(core->getThread()->getId()))
+      return true;
+
+   if (siblings && !m_fastforward)
+   {
+      for (core_id_t sibling = 0; sibling < (core_id_t) Sim()->getConfig()->getApplicationCores(); sibling++)
+         if (m_core_group[sibling] == core_id && isCoreRunning(sibling, false))
+            return true;
+   }
+
+   return false;
+}
+
+void
+SlackSyncServer::refreshRunning()
+{
+   // Called with the thread manager lock held, after a thread started, stopped or moved:
+   // cores that are not running no longer hold back the minimum, cores that (re)start join at their own time
+   for (core_id_t core_id = 0; core_id < (core_id_t) Sim()->getConfig()->getApplicationCores(); core_id++)
+   {
+      if (getMaster(core_id) != core_id || !isCoreRunning(core_id))
+         setClock(core_id, SubsecondTime::MaxTime());
+      else if (getClock(core_id) == SubsecondTime::MaxTime())
+      {
+         SubsecondTime time = Sim()->getCoreManager()->getCoreFromID(core_id)->getPerformanceModel()->getElapsedTime();
+         setClock(core_id, std::max(time, m_global_time));
+      }
+   }
+   __sync_synchronize();
+   updateMinimum();
+
+   if (m_disable)
+      return;
+
+   periodic();
+   wakeWaiters();
+}
+
+void
+SlackSyncServer::periodic()
+{
+   // Callbacks that reschedule threads end up in refreshRunning(), which calls us again
+   if (m_in_periodic)
+      return;
+   m_in_periodic = true;
+
+   // Call HOOK_PERIODIC for every periodic boundary the slowest running core has passed.
+   // All other running cores are then at or past the boundary, so they are blocked in synchronize().
+   SubsecondTime minimum = updateMinimum();
+   while (minimum != SubsecondTime::MaxTime() && minimum >= m_next_periodic && !m_disable)
+   {
+      // In fast-forward mode, skip over (potentially very many) timeslots
+      if (m_fastforward)
+         m_next_periodic = minimum;
+
+      m_global_time = m_next_periodic;
+      ++m_num_periodic;
+      CLOG("slack", "Periodic %" PRId64 "ns", m_next_periodic.getNS());
+      Sim()->getHooksManager()->callHooks(HookType::HOOK_PERIODIC, static_cast<subsecond_time_t>(m_next_periodic).m_time);
+      m_next_periodic += m_periodic_interval;
+
+      // Callbacks may have rescheduled threads
+      minimum = updateMinimum();
+   }
+
+   m_in_periodic = false;
+}
+
+void
+SlackSyncServer::wakeWaiters()
+{
+   if (m_num_waiting == 0)
+      return;
+
+   SubsecondTime minimum = updateMinimum();
+
+   for (core_id_t core_id = 0; core_id < (core_id_t) Sim()->getConfig()->getApplicationCores(); core_id++)
+   {
+      if (m_core_waiting[core_id] && !isAhead(getClock(core_id), minimum))
+      {
+         m_core_waiting[core_id] = false;
+         m_core_cond[core_id]->signal();
+      }
+   }
+}
+
+void
+SlackSyncServer::release()
+{
+   CLOG("slack", "Release");
+   ++m_release_count;
+   for (core_id_t core_id = 0; core_id < (core_id_t) Sim()->getConfig()->getApplicationCores(); core_id++)
+   {
+      if (m_core_waiting[core_id])
+      {
+         m_core_waiting[core_id] = false;
+         m_core_cond[core_id]->signal();
+      }
+   }
+}
+
+void
+SlackSyncServer::advance()
+{
+   // All threads are stalled: move time forward so sleeping threads and futex timeouts can wake up
+   m_global_time = m_next_periodic;
+   ++m_num_periodic;
+   Sim()->getHooksManager()->callHooks(HookType::HOOK_PERIODIC, static_cast<subsecond_time_t>(m_next_periodic).m_time);
+   m_next_periodic += m_periodic_interval;
+
+   if (!Sim()->getThreadManager()->anyThreadRunning())
+      LOG_ASSERT_ERROR(Sim()->getSyscallServer()->getNextTimeout(m_global_time) < SubsecondTime::MaxTime(), "No threads running, no timeout. Application has deadlocked...");
+}
+
+void
+SlackSyncServer::setDisable(bool disable)
+{
+   m_disable = disable;
+   if (disable)
+      release();
+}
+
+void
+SlackSyncServer::setGroup(core_id_t core_id, core_id_t master_core_id)
+{
+   m_core_group[core_id] = master_core_id;
+   refreshRunning();
+}
+
+void
+SlackSyncServer::setFastForward(bool fastforward, SubsecondTime next_barrier_time)
+{
+   if (m_fastforward != fastforward)
+      CLOG("slack", "FastForward %d > %d", m_fastforward, fastforward);
+   m_fastforward = fastforward;
+   if (next_barrier_time != SubsecondTime::MaxTime())
+      m_next_periodic = std::max(m_next_periodic, next_barrier_time);
+   // Group masters change between fast-forward and detailed mode
+   refreshRunning();
+   release();
+}
+
+void
+SlackSyncServer::printState(void)
+{
+   SubsecondTime minimum = getMinimum();
+   printf("Slack state (minimum %" PRId64 " ns):", minimum == SubsecondTime::MaxTime() ? -1 : SInt64(minimum.getNS()));
+   for(core_id_t core_id = 0; core_id < (core_id_t) Sim()->getConfig()->getApplicationCores(); core_id++)
+   {
+      if (getClock(core_id) == SubsecondTime::MaxTime())
+         printf(" _");
+      else if (m_core_waiting[core_id])
+         printf(" W+%" PRId64, SInt64((getClock(core_id) - minimum).getNS()));
+      else
+         printf(" R+%" PRId64, SInt64((getClock(core_id) - minimum).getNS()));
+   }
+   printf("\n");
+}
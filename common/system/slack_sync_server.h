@@ -0,0 +1,89 @@
+#ifndef __SLACK_SYNC_SERVER_H__
+#define __SLACK_SYNC_SERVER_H__
+
+#include "fixed_types.h"
+#include "clock_skew_minimization_object.h"
+#include "cond.h"
+#include "hooks_manager.h"
+
+#include <vector>
+
+// Bounded-slack (lax) synchronization: rather than waiting for all cores at every quantum, a core only blocks
+// when it gets more than `slack` ahead of the slowest running core. Core clocks are published without locks,
+// the thread manager lock is only taken to block, to wake up blocked cores, or to call HOOK_PERIODIC.
+// HOOK_PERIODIC callbacks (schedulers, partitioning, statistics snapshots) expect all cores to be stopped, so
+// every running core blocks at each periodic boundary, and the last one to arrive calls HOOK_PERIODIC, like the barrier.
+// Periodic boundaries are therefore further apart (slack/periodic) than the quantum at which cores report their time.
+class SlackSyncServer : public ClockSkewMinimizationServer
+{
+   private:
+      // Per-core clock in fs, SubsecondTime::MaxTime() when not running (or not a group master).
+      // One cache line each (allocated with aligned_alloc), so cores updating their own clock do not share lines.
+      struct CoreClock
+      {
+         volatile UInt64 time;
+      } __attribute__((aligned(64)));
+
+      struct CoreStats
+      {
+         UInt64 num_syncs;
+         UInt64 num_stalls;
+         UInt64 stall_host_time;      // Host time spent blocked, in ns
+         SubsecondTime skew_max;      // Largest distance ahead of the slowest core seen at a sync point
+         SubsecondTime skew_total;    // Sum of distances, for the average skew
+      };
+
+      SubsecondTime m_slack;
+      SubsecondTime m_interval;            // Cores report their clock every quantum
+      SubsecondTime m_periodic_interval;   // HOOK_PERIODIC boundaries
+      SubsecondTime m_next_periodic;
+      SubsecondTime m_global_time;
+      CoreClock *m_core_clock;
+      // Lower bound on the minimum running core clock, in fs. Only cores at the minimum can move it, so only they rescan.
+      volatile UInt64 m_minimum;
+      std::vector<CoreStats> m_core_stats;
+      std::vector<ConditionVariable*> m_core_cond;
+      std::vector<bool> m_core_waiting;
+      std::vector<core_id_t> m_core_group;
+      volatile UInt32 m_num_waiting;
+      UInt64 m_release_count;          // Incremented by release(), blocked cores give up waiting when it changes
+      UInt64 m_num_periodic;
+      bool m_in_periodic;
+      bool m_fastforward;
+      volatile bool m_disable;
+
+      core_id_t getMaster(core_id_t core_id) const
+      { return (m_fastforward || m_core_group[core_id] == INVALID_CORE_ID) ? core_id : m_core_group[core_id]; }
+      SubsecondTime getClock(core_id_t core_id) const { return SubsecondTime::FS(m_core_clock[core_id].time); }
+      void setClock(core_id_t core_id, SubsecondTime time) { m_core_clock[core_id].time = time.getFS(); }
+      SubsecondTime getMinimum() const;
+      SubsecondTime updateMinimum();
+      bool isAhead(SubsecondTime time, SubsecondTime minimum) const
+      { return time >= m_next_periodic || (!m_fastforward && time > minimum + m_slack); }
+      bool isCoreRunning(core_id_t core_id, bool siblings = true);
+      void refreshRunning(void);
+      void periodic(void);
+      void wakeWaiters(void);
+
+      static SInt64 hookThreadChange(UInt64 object, UInt64 argument) {
+         ((SlackSyncServer*)object)->refreshRunning(); return 0;
+      }
+
+   public:
+      SlackSyncServer();
+      ~SlackSyncServer();
+
+      virtual void setDisable(bool disable);
+      virtual void setGroup(core_id_t core_id, core_id_t master_core_id);
+      void synchronize(core_id_t core_id, SubsecondTime time);
+      void release();
+      void advance();
+      void setFastForward(bool fastforward, SubsecondTime next_barrier_time = SubsecondTime::MaxTime());
+      SubsecondTime getGlobalTime(bool upper_bound = false) { return upper_bound ? m_next_periodic : m_global_time; }
+      void setBarrierInterval(SubsecondTime barrier_interval) { m_interval = barrier_interval; }
+      SubsecondTime getBarrierInterval() const { return m_interval; }
+
+      void printState(void);
+};
+
+#endif /* __SLACK_SYNC_SERVER_H__ */
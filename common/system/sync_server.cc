@@ -35,17 +35,29 @@ bool SimMutex::isLocked(thread_id_t thread_id)
       return true;
 }
 
-SubsecondTime SimMutex::lock(thread_id_t thread_id, SubsecondTime time)
+bool SimMutex::tryLock(thread_id_t thread_id)
 {
    if (m_owner == NO_OWNER)
    {
       m_owner = thread_id;
-      return time;
+      return true;
+   }
+   else
+   {
+      return false;
+   }
+}
+
+bool SimMutex::lock(thread_id_t thread_id)
+{
+   if (tryLock(thread_id))
+   {
+      return true;
    }
    else
    {
       m_waiting.push(thread_id);
-      return Sim()->getThreadManager()->stallThread(thread_id, ThreadManager::STALL_MUTEX, time);
+      return false;
    }
 }
 
@@ -97,13 +109,11 @@ SimCond::~SimCond()
    #endif
 }
 
-SubsecondTime SimCond::wait(thread_id_t thread_id, SubsecondTime time, SimMutex * simMux)
+void SimCond::wait(thread_id_t thread_id, SubsecondTime time, SimMutex * simMux)
 {
    simMux->unlock(thread_id, time);
 
    m_waiting.push(CondWaiter(thread_id, simMux));
-
-   return Sim()->getThreadManager()->stallThread(thread_id, ThreadManager::STALL_COND, time);
 }
 
 thread_id_t SimCond::signal(thread_id_t thread_id, SubsecondTime time)
@@ -158,7 +168,7 @@ SimBarrier::~SimBarrier()
    }
 }
 
-SubsecondTime SimBarrier::wait(thread_id_t thread_id, SubsecondTime time)
+bool SimBarrier::wait(thread_id_t thread_id, SubsecondTime time)
 {
    // We are the last thread to reach the barrier
    if (m_waiting.size() == m_count - 1)
@@ -171,12 +181,12 @@ SubsecondTime SimBarrier::wait(thread_id_t thread_id, SubsecondTime time)
          m_waiting.pop();
          Sim()->getThreadManager()->resumeThread(waiter, thread_id, time);
       }
-      return time;
+      return false;
    }
    else
    {
       m_waiting.push(thread_id);
-      return Sim()->getThreadManager()->stallThread(thread_id, ThreadManager::STALL_BARRIER, time);
+      return true;
    }
 }
 
@@ -210,30 +220,59 @@ SimMutex * SyncServer::getMutex(carbon_mutex_t *mux, bool canCreate)
 
 void SyncServer::mutexInit(thread_id_t thread_id, carbon_mutex_t *mux)
 {
-   ScopedLock sl(Sim()->getThreadManager()->getLock());
+   ScopedLock sl(m_lock);
    getMutex(mux);
 }
 
 std::pair<SubsecondTime, bool> SyncServer::mutexLock(thread_id_t thread_id, carbon_mutex_t *mux, bool tryLock, SubsecondTime time)
 {
-   ScopedLock sl(Sim()->getThreadManager()->getLock());
-   SimMutex *psimmux = getMutex(mux);
-
-   if (tryLock && psimmux->isLocked(thread_id))
+   // Fast path: the mutex is free, or this is a trylock that fails
    {
-      // notify the owner of failure
-      return std::make_pair(time, false);
+      ScopedLock sl(m_lock);
+      SimMutex *psimmux = getMutex(mux);
+
+      if (psimmux->tryLock(thread_id))
+         return std::make_pair(time + m_reschedule_cost, true);
+      else if (tryLock && psimmux->isLocked(thread_id))
+         return std::make_pair(time, false);
    }
-   else
+
+   // We (probably) need to stall: this requires the thread manager lock, then check again
+   ScopedLock sl_tm(Sim()->getThreadManager()->getLock());
+   bool owned;
    {
-      SubsecondTime time_end = psimmux->lock(thread_id, time);
-      return std::make_pair(time_end + m_reschedule_cost, true);
+      ScopedLock sl(m_lock);
+      SimMutex *psimmux = getMutex(mux);
+
+      if (tryLock && psimmux->isLocked(thread_id))
+      {
+         // notify the owner of failure
+         return std::make_pair(time, false);
+      }
+      owned = psimmux->lock(thread_id);
    }
+
+   SubsecondTime time_end = owned ? time : Sim()->getThreadManager()->stallThread(thread_id, ThreadManager::STALL_MUTEX, time);
+   return std::make_pair(time_end + m_reschedule_cost, true);
 }
 
 SubsecondTime SyncServer::mutexUnlock(thread_id_t thread_id, carbon_mutex_t *mux, SubsecondTime time)
 {
-   ScopedLock sl(Sim()->getThreadManager()->getLock());
+   // Fast path: no one to wake up. Waiters are only added while holding the thread manager lock,
+   // and are still running until they stall, so they will not miss this unlock
+   {
+      ScopedLock sl(m_lock);
+      SimMutex *psimmux = getMutex(mux, false);
+
+      if (!psimmux->hasWaiters())
+      {
+         psimmux->unlock(thread_id, time + m_reschedule_cost);
+         return time;
+      }
+   }
+
+   ScopedLock sl_tm(Sim()->getThreadManager()->getLock());
+   ScopedLock sl(m_lock);
    SimMutex *psimmux = getMutex(mux, false);
 
    thread_id_t new_owner = psimmux->unlock(thread_id, time + m_reschedule_cost);
@@ -263,22 +302,35 @@ SimCond * SyncServer::getCond(carbon_cond_t *cond, bool canCreate)
 
 void SyncServer::condInit(thread_id_t thread_id, carbon_cond_t *cond)
 {
-   ScopedLock sl(Sim()->getThreadManager()->getLock());
+   ScopedLock sl(m_lock);
    getCond(cond);
 }
 
 SubsecondTime SyncServer::condWait(thread_id_t thread_id, carbon_cond_t *cond, carbon_mutex_t *mux, SubsecondTime time)
 {
-   ScopedLock sl(Sim()->getThreadManager()->getLock());
-   SimMutex *psimmux = getMutex(mux);
-   SimCond *psimcond = getCond(cond);
+   ScopedLock sl_tm(Sim()->getThreadManager()->getLock());
+   {
+      ScopedLock sl(m_lock);
+      SimMutex *psimmux = getMutex(mux);
+      SimCond *psimcond = getCond(cond);
+
+      psimcond->wait(thread_id, time, psimmux);
+   }
 
-   return psimcond->wait(thread_id, time, psimmux);
+   return Sim()->getThreadManager()->stallThread(thread_id, ThreadManager::STALL_COND, time);
 }
 
 SubsecondTime SyncServer::condSignal(thread_id_t thread_id, carbon_cond_t *cond, SubsecondTime time)
 {
-   ScopedLock sl(Sim()->getThreadManager()->getLock());
+   // Fast path: no waiters, nothing to do
+   {
+      ScopedLock sl(m_lock);
+      if (!getCond(cond)->hasWaiters())
+         return time;
+   }
+
+   ScopedLock sl_tm(Sim()->getThreadManager()->getLock());
+   ScopedLock sl(m_lock);
    SimCond *psimcond = getCond(cond);
 
    psimcond->signal(thread_id, time);
@@ -288,7 +340,14 @@ SubsecondTime SyncServer::condSignal(thread_id_t thread_id, carbon_cond_t *cond,
 
 SubsecondTime SyncServer::condBroadcast(thread_id_t thread_id, carbon_cond_t *cond, SubsecondTime time)
 {
-   ScopedLock sl(Sim()->getThreadManager()->getLock());
+   {
+      ScopedLock sl(m_lock);
+      if (!getCond(cond)->hasWaiters())
+         return time;
+   }
+
+   ScopedLock sl_tm(Sim()->getThreadManager()->getLock());
+   ScopedLock sl(m_lock);
    SimCond *psimcond = getCond(cond);
 
    psimcond->broadcast(thread_id, time);
@@ -298,7 +357,7 @@ SubsecondTime SyncServer::condBroadcast(thread_id_t thread_id, carbon_cond_t *co
 
 void SyncServer::barrierInit(thread_id_t thread_id, carbon_barrier_t *barrier, UInt32 count)
 {
-   ScopedLock sl(Sim()->getThreadManager()->getLock());
+   ScopedLock sl(m_lock);
 
    m_barriers.push_back(SimBarrier(count));
    *barrier = (carbon_barrier_t)m_barriers.size()-1;
@@ -306,8 +365,14 @@ void SyncServer::barrierInit(thread_id_t thread_id, carbon_barrier_t *barrier, U
 
 SubsecondTime SyncServer::barrierWait(thread_id_t thread_id, carbon_barrier_t *barrier, SubsecondTime time)
 {
-   ScopedLock sl(Sim()->getThreadManager()->getLock());
-   SimBarrier *psimbarrier = &m_barriers[*barrier];
+   ScopedLock sl_tm(Sim()->getThreadManager()->getLock());
+   bool must_stall;
+   {
+      ScopedLock sl(m_lock);
+      SimBarrier *psimbarrier = &m_barriers[*barrier];
+
+      must_stall = psimbarrier->wait(thread_id, time);
+   }
 
-   return psimbarrier->wait(thread_id, time);
+   return must_stall ? Sim()->getThreadManager()->stallThread(thread_id, ThreadManager::STALL_BARRIER, time) : time;
 }
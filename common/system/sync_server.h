@@ -7,6 +7,7 @@
 #include "network.h"
 #include "packetize.h"
 #include "stable_iterator.h"
+#include "lock.h"
 
 #include <queue>
 #include <vector>
@@ -25,8 +26,14 @@ class SimMutex
       // returns true if the lock is owned by someone that is not this thread
       bool isLocked(thread_id_t thread_id);
 
-      // returns the time when this thread owns the lock
-      SubsecondTime lock(thread_id_t thread_id, SubsecondTime time);
+      bool hasWaiters() const { return !m_waiting.empty(); }
+
+      // takes the lock if it is free, never stalls
+      bool tryLock(thread_id_t thread_id);
+
+      // takes the lock if it is free and returns true, else adds this thread to the waiters and returns false:
+      // the caller must then stall (without releasing the thread manager lock in between), it owns the lock once resumed
+      bool lock(thread_id_t thread_id);
 
       // try to take the lock in name of another thread, either waking them or adding them to the list
       bool lock_async(thread_id_t thread_id, thread_id_t thread_by, SubsecondTime time);
@@ -48,7 +55,10 @@ class SimCond
       SimCond();
       ~SimCond();
 
-      SubsecondTime wait(thread_id_t thread_id, SubsecondTime time, SimMutex * mux);
+      bool hasWaiters() const { return !m_waiting.empty(); }
+
+      // releases mux and adds this thread to the waiters, the caller must stall
+      void wait(thread_id_t thread_id, SubsecondTime time, SimMutex * mux);
       thread_id_t signal(thread_id_t thread_id, SubsecondTime time);
       void broadcast(thread_id_t thread_id, SubsecondTime time);
 
@@ -72,7 +82,8 @@ class SimBarrier
       SimBarrier(UInt32 count);
       ~SimBarrier();
 
-      SubsecondTime wait(thread_id_t thread_id, SubsecondTime time);
+      // returns true if this thread has to stall until the last thread arrives
+      bool wait(thread_id_t thread_id, SubsecondTime time);
 
    private:
       typedef std::queue<thread_id_t> ThreadQueue;
@@ -91,6 +102,12 @@ class SyncServer
       CondVector m_conds;
       BarrierVector m_barriers;
 
+      // Protects the objects above. Operations that do not need to stall or resume a thread
+      // (uncontended lock and unlock, signals without waiters) only take this lock;
+      // all others take the thread manager lock first, and release m_lock before stalling.
+      // Lock order: thread manager lock, then m_lock.
+      Lock m_lock;
+
    public:
       SyncServer();
       ~SyncServer();
@@ -13,7 +13,11 @@
 #include <sys/syscall.h>
 #include "os_compat.h"
 
+#include <algorithm>
+
 SyscallServer::SyscallServer()
+   : m_timeout_seq(0)
+   , m_num_timed_waits(0)
 {
    m_reschedule_cost = SubsecondTime::NS() * Sim()->getCfg()->getInt("perf_model/sync/reschedule_cost");
 
@@ -28,13 +32,13 @@ void SyscallServer::handleSleepCall(thread_id_t thread_id, SubsecondTime wake_ti
 {
    ScopedLock sl(Sim()->getThreadManager()->getLock());
 
-   m_sleeping.push_back(SimFutex::Waiter(thread_id, 0, wake_time));
+   addTimeout(thread_id, wake_time, NULL);
    end_time = Sim()->getThreadManager()->stallThread(thread_id, ThreadManager::STALL_SLEEP, curr_time);
+   cancelTimeout(thread_id);
 }
 
 IntPtr SyscallServer::handleFutexCall(thread_id_t thread_id, futex_args_t &args, SubsecondTime curr_time, SubsecondTime &end_time)
 {
-   ScopedLock sl(Sim()->getThreadManager()->getLock());
    CLOG("futex", "Futex enter thread %d", thread_id);
 
    int cmd = (args.op & FUTEX_CMD_MASK) & ~FUTEX_PRIVATE_FLAG;
@@ -79,9 +83,31 @@ IntPtr SyscallServer::handleFutexCall(thread_id_t thread_id, futex_args_t &args,
 
    core->accessMemory(Core::NONE, Core::READ, (IntPtr) args.uaddr, (char*) &act_val, sizeof(act_val));
 
+   // Fast paths that neither stall nor wake up a thread, and can do without the thread manager lock
+   if ((cmd == FUTEX_WAIT || cmd == FUTEX_WAIT_BITSET) && args.val != act_val)
+   {
+      end_time = curr_time;
+      CLOG("futex", "Futex leave thread %d (value changed)", thread_id);
+      return -EWOULDBLOCK;
+   }
+   else if (cmd == FUTEX_WAKE || cmd == FUTEX_WAKE_BITSET)
+   {
+      // Waiters enqueue themselves while holding m_futex_lock, after checking the futex value:
+      // if there is no waiter now, any thread that is about to wait will see the value we were woken up for
+      ScopedLock sl(m_futex_lock);
+      if (!findFutexByUaddr(args.uaddr, thread_id)->hasWaiters())
+      {
+         end_time = curr_time;
+         CLOG("futex", "Futex leave thread %d (no waiters)", thread_id);
+         return 0;
+      }
+   }
+
+   ScopedLock sl(Sim()->getThreadManager()->getLock());
+
    if (cmd == FUTEX_WAIT || cmd == FUTEX_WAIT_BITSET)
    {
-      res = futexWait(thread_id, args.uaddr, args.val, act_val, cmd == FUTEX_WAIT_BITSET ? args.val3 : FUTEX_BITSET_MATCH_ANY, curr_time, timeout_time, end_time);
+      res = futexWait(thread_id, core, args.uaddr, args.val, cmd == FUTEX_WAIT_BITSET ? args.val3 : FUTEX_BITSET_MATCH_ANY, curr_time, timeout_time, end_time);
    }
    else if (cmd == FUTEX_WAKE || cmd == FUTEX_WAKE_BITSET)
    {
@@ -128,10 +154,20 @@ SimFutex* SyscallServer::findFutexByUaddr(int *uaddr, thread_id_t thread_id)
    return sim_futex;
 }
 
-IntPtr SyscallServer::futexWait(thread_id_t thread_id, int *uaddr, int val, int act_val, int mask, SubsecondTime curr_time, SubsecondTime timeout_time, SubsecondTime &end_time)
+IntPtr SyscallServer::futexWait(thread_id_t thread_id, Core *core, int *uaddr, int val, int mask, SubsecondTime curr_time, SubsecondTime timeout_time, SubsecondTime &end_time)
 {
    LOG_PRINT("Futex Wait");
-   SimFutex *sim_futex = findFutexByUaddr(uaddr, thread_id);
+   SimFutex *sim_futex;
+   int act_val;
+
+   {
+      // Check the value and enqueue atomically with respect to the FUTEX_WAKE fast path
+      ScopedLock sl(m_futex_lock);
+      sim_futex = findFutexByUaddr(uaddr, thread_id);
+      core->accessMemory(Core::NONE, Core::READ, (IntPtr) uaddr, (char*) &act_val, sizeof(act_val));
+      if (val == act_val)
+         sim_futex->enqueueWaiter(thread_id, mask, timeout_time);
+   }
 
    if (val != act_val)
    {
@@ -140,7 +176,12 @@ IntPtr SyscallServer::futexWait(thread_id_t thread_id, int *uaddr, int val, int
    }
    else
    {
-      bool success = sim_futex->enqueueWaiter(thread_id, mask, curr_time, timeout_time, end_time);
+      if (timeout_time != SubsecondTime::MaxTime())
+         addTimeout(thread_id, timeout_time, sim_futex);
+      end_time = Sim()->getThreadManager()->stallThread(thread_id, ThreadManager::STALL_FUTEX, curr_time);
+      bool success = Sim()->getThreadManager()->getThreadFromID(thread_id)->getWakeupMsg();
+      // If we were woken up by futexWake, our timeout entry is still in the heap: make it stale
+      cancelTimeout(thread_id);
       if (success)
          return 0;
       else
@@ -157,6 +198,7 @@ thread_id_t SyscallServer::wakeFutexOne(SimFutex *sim_futex, thread_id_t thread_
 IntPtr SyscallServer::futexWake(thread_id_t thread_id, int *uaddr, int nr_wake, int mask, SubsecondTime curr_time, SubsecondTime &end_time)
 {
    LOG_PRINT("Futex Wake");
+   ScopedLock sl(m_futex_lock);
    SimFutex *sim_futex = findFutexByUaddr(uaddr, thread_id);
    int num_procs_woken_up = 0;
 
@@ -244,6 +286,7 @@ int SyscallServer::futexDoOp(Core *core, int encoded_op, int *uaddr)
 IntPtr SyscallServer::futexWakeOp(thread_id_t thread_id, int *uaddr, int *uaddr2, int nr_wake, int nr_wake2, int op, SubsecondTime curr_time, SubsecondTime &end_time)
 {
    LOG_PRINT("Futex WakeOp");
+   ScopedLock sl(m_futex_lock);
    SimFutex *sim_futex = findFutexByUaddr(uaddr, thread_id);
    SimFutex *sim_futex2 = findFutexByUaddr(uaddr2, thread_id);
    int num_procs_woken_up = 0;
@@ -280,6 +323,7 @@ IntPtr SyscallServer::futexWakeOp(thread_id_t thread_id, int *uaddr, int *uaddr2
 IntPtr SyscallServer::futexCmpRequeue(thread_id_t thread_id, int *uaddr, int val, int *uaddr2, int val3, int act_val, SubsecondTime curr_time, SubsecondTime &end_time)
 {
    LOG_PRINT("Futex CMP_REQUEUE");
+   ScopedLock sl(m_futex_lock);
    SimFutex *sim_futex = findFutexByUaddr(uaddr, thread_id);
    int num_procs_woken_up = 0;
 
@@ -310,6 +354,9 @@ IntPtr SyscallServer::futexCmpRequeue(thread_id_t thread_id, int *uaddr, int val
          thread_id_t waiter = sim_futex->requeueWaiter(requeue_futex);
          if(waiter == INVALID_THREAD_ID)
             break;
+         // A timed-out waiter needs to be removed from its new futex
+         if (waiter < (thread_id_t)m_timed_waits.size() && m_timed_waits[waiter].seq)
+            m_timed_waits[waiter].futex = requeue_futex;
       }
 
       end_time = curr_time;
@@ -319,44 +366,78 @@ IntPtr SyscallServer::futexCmpRequeue(thread_id_t thread_id, int *uaddr, int val
 
 void SyscallServer::futexPeriodic(SubsecondTime time)
 {
-   // Wake sleeping threads
-   for(SimFutex::ThreadQueue::iterator it = m_sleeping.begin(); it != m_sleeping.end(); ++it)
+   // Wake all sleeping threads and timed-out futex waiters that are due, in timeout order
+   while (!m_timeouts.empty() && m_timeouts.front().timeout <= time)
    {
-      if (it->timeout <= time)
-      {
-         thread_id_t waiter = it->thread_id;
-         m_sleeping.erase(it);
+      Timeout entry = m_timeouts.front();
+      std::pop_heap(m_timeouts.begin(), m_timeouts.end());
+      m_timeouts.pop_back();
 
-         Sim()->getThreadManager()->resumeThread(waiter, waiter, time, (void*)false);
+      if (!isTimeoutValid(entry))
+         continue;
 
-         // Iterator will be invalid, wake up potential others in the next barrier synchronization which should only be 100ns away
-         break;
+      SimFutex *sim_futex = m_timed_waits[entry.thread_id].futex;
+      cancelTimeout(entry.thread_id);
+
+      // Futex waiters may have been woken up already (but not yet have returned from their wait)
+      bool removed = true;
+      if (sim_futex)
+      {
+         ScopedLock sl(m_futex_lock);
+         removed = sim_futex->removeWaiter(entry.thread_id);
       }
+      if (removed)
+         Sim()->getThreadManager()->resumeThread(entry.thread_id, entry.thread_id, time, (void*)false);
    }
-   // Wake timeout futexes
-   for(FutexMap::iterator it = m_futexes.begin(); it != m_futexes.end(); ++it)
+}
+
+SubsecondTime SyscallServer::getNextTimeout(SubsecondTime time)
+{
+   // Drop stale entries from the top, the first valid one is the next timeout
+   while (!m_timeouts.empty() && !isTimeoutValid(m_timeouts.front()))
    {
-      it->second.wakeTimedOut(time);
+      std::pop_heap(m_timeouts.begin(), m_timeouts.end());
+      m_timeouts.pop_back();
    }
+   return m_timeouts.empty() ? SubsecondTime::MaxTime() : m_timeouts.front().timeout;
 }
 
-SubsecondTime SyscallServer::getNextTimeout(SubsecondTime time)
+void SyscallServer::addTimeout(thread_id_t thread_id, SubsecondTime timeout, SimFutex *sim_futex)
 {
-   SubsecondTime next = SubsecondTime::MaxTime();
-   // Sleeping threads
-   for(SimFutex::ThreadQueue::iterator it = m_sleeping.begin(); it != m_sleeping.end(); ++it)
+   if (thread_id >= (thread_id_t)m_timed_waits.size())
    {
-      if (it->timeout < SubsecondTime::MaxTime())
-         next = it->timeout;
+      TimedWait none = { 0, NULL };
+      m_timed_waits.resize(thread_id + 1, none);
    }
-   // Timeout futexes
-   for(FutexMap::iterator it = m_futexes.begin(); it != m_futexes.end(); ++it)
+   LOG_ASSERT_ERROR(m_timed_waits[thread_id].seq == 0, "Thread %d is already in a timed wait", thread_id);
+
+   m_timed_waits[thread_id].seq = ++m_timeout_seq;
+   m_timed_waits[thread_id].futex = sim_futex;
+   ++m_num_timed_waits;
+
+   // Waits that end early leave stale entries behind, rebuild the heap when they start to dominate
+   if (m_timeouts.size() > 1024 && m_timeouts.size() > 4 * m_num_timed_waits)
    {
-      SubsecondTime t = it->second.getNextTimeout(time);
-      if (t < next)
-         next = t;
+      std::vector<Timeout> valid;
+      for(std::vector<Timeout>::iterator it = m_timeouts.begin(); it != m_timeouts.end(); ++it)
+         if (isTimeoutValid(*it))
+            valid.push_back(*it);
+      m_timeouts.swap(valid);
+      std::make_heap(m_timeouts.begin(), m_timeouts.end());
+   }
+
+   m_timeouts.push_back(Timeout(timeout, thread_id, m_timeout_seq));
+   std::push_heap(m_timeouts.begin(), m_timeouts.end());
+}
+
+void SyscallServer::cancelTimeout(thread_id_t thread_id)
+{
+   if (thread_id < (thread_id_t)m_timed_waits.size() && m_timed_waits[thread_id].seq)
+   {
+      m_timed_waits[thread_id].seq = 0;
+      m_timed_waits[thread_id].futex = NULL;
+      --m_num_timed_waits;
    }
-   return next;
 }
 
 // -- SimFutex -- //
@@ -379,11 +460,9 @@ SimFutex::~SimFutex()
    #endif
 }
 
-bool SimFutex::enqueueWaiter(thread_id_t thread_id, int mask, SubsecondTime time, SubsecondTime timeout_time, SubsecondTime &time_end)
+void SimFutex::enqueueWaiter(thread_id_t thread_id, int mask, SubsecondTime timeout_time)
 {
    m_waiting.push_back(Waiter(thread_id, mask, timeout_time));
-   time_end = Sim()->getThreadManager()->stallThread(thread_id, ThreadManager::STALL_FUTEX, time);
-   return Sim()->getThreadManager()->getThreadFromID(thread_id)->getWakeupMsg();
 }
 
 thread_id_t SimFutex::dequeueWaiter(thread_id_t thread_by, int mask, SubsecondTime time)
@@ -421,30 +500,15 @@ thread_id_t SimFutex::requeueWaiter(SimFutex *requeue_futex)
    }
 }
 
-void SimFutex::wakeTimedOut(SubsecondTime time)
+bool SimFutex::removeWaiter(thread_id_t thread_id)
 {
    for(ThreadQueue::iterator it = m_waiting.begin(); it != m_waiting.end(); ++it)
    {
-      if (it->timeout <= time)
+      if (it->thread_id == thread_id)
       {
-         thread_id_t waiter = it->thread_id;
          m_waiting.erase(it);
-
-         Sim()->getThreadManager()->resumeThread(waiter, INVALID_THREAD_ID, time, (void*)false);
-
-         // Iterator will be invalid, wake up potential others in the next barrier synchronization which should only be 100ns away
-         break;
+         return true;
       }
    }
-}
-
-SubsecondTime SimFutex::getNextTimeout(SubsecondTime time)
-{
-   SubsecondTime next = SubsecondTime::MaxTime();
-   for(ThreadQueue::iterator it = m_waiting.begin(); it != m_waiting.end(); ++it)
-   {
-      if (it->timeout < SubsecondTime::MaxTime())
-         next = it->timeout;
-   }
-   return next;
+   return false;
 }
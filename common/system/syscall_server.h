@@ -3,10 +3,12 @@
 
 #include "fixed_types.h"
 #include "subsecond_time.h"
+#include "lock.h"
 
 #include <iostream>
 #include <unordered_map>
 #include <list>
+#include <vector>
 
 // -- For futexes --
 #include <linux/futex.h>
@@ -36,11 +38,12 @@ class SimFutex
    public:
       SimFutex();
       ~SimFutex();
-      bool enqueueWaiter(thread_id_t thread_id, int mask, SubsecondTime time, SubsecondTime timeout_time, SubsecondTime &time_end);
+      bool hasWaiters() const { return !m_waiting.empty(); }
+      // Adds thread_id to the waiters, the caller must stall it (without releasing the thread manager lock in between)
+      void enqueueWaiter(thread_id_t thread_id, int mask, SubsecondTime timeout_time);
       thread_id_t dequeueWaiter(thread_id_t thread_by, int mask, SubsecondTime time);
       thread_id_t requeueWaiter(SimFutex *requeue_futex);
-      void wakeTimedOut(SubsecondTime time);
-      SubsecondTime getNextTimeout(SubsecondTime time);
+      bool removeWaiter(thread_id_t thread_id);
 };
 
 class SyscallServer
@@ -65,7 +68,7 @@ class SyscallServer
 
    private:
       // Handling Futexes
-      IntPtr futexWait(thread_id_t thread_id, int *uaddr, int val, int act_val, int val3, SubsecondTime curr_time, SubsecondTime timeout_time, SubsecondTime &end_time);
+      IntPtr futexWait(thread_id_t thread_id, Core *core, int *uaddr, int val, int val3, SubsecondTime curr_time, SubsecondTime timeout_time, SubsecondTime &end_time);
       IntPtr futexWake(thread_id_t thread_id, int *uaddr, int nr_wake, int val3, SubsecondTime curr_time, SubsecondTime &end_time);
       IntPtr futexWakeOp(thread_id_t thread_id, int *uaddr, int *uaddr2, int nr_wake, int nr_wake2, int op, SubsecondTime curr_time, SubsecondTime &end_time);
       IntPtr futexCmpRequeue(thread_id_t thread_id, int *uaddr, int val, int *uaddr2, int val3, int act_val, SubsecondTime curr_time, SubsecondTime &end_time);
@@ -76,6 +79,9 @@ class SyscallServer
 
       void futexPeriodic(SubsecondTime time);
 
+      void addTimeout(thread_id_t thread_id, SubsecondTime timeout, SimFutex *sim_futex);
+      void cancelTimeout(thread_id_t thread_id);
+
       SubsecondTime applyRescheduleCost(thread_id_t thread_id, bool conditional = true);
 
       static SInt64 hook_periodic(UInt64 ptr, UInt64 time)
@@ -86,12 +92,40 @@ class SyscallServer
 
       SubsecondTime m_reschedule_cost;
 
-      // Sleeping threads
-      SimFutex::ThreadQueue m_sleeping;
+      // Timeouts of sleeping threads and timed futex waits, as a min-heap on timeout.
+      // Entries are not removed when a waiter is woken up otherwise; instead, they become stale
+      // when the thread's current timed wait (m_timed_waits) has a different sequence number.
+      struct Timeout
+      {
+         Timeout(SubsecondTime _timeout, thread_id_t _thread_id, UInt64 _seq)
+            : timeout(_timeout), thread_id(_thread_id), seq(_seq)
+            {}
+         SubsecondTime timeout;
+         thread_id_t thread_id;
+         UInt64 seq;
+         // Heap order: earliest timeout on top
+         bool operator<(const Timeout &other) const { return timeout > other.timeout; }
+      };
+      std::vector<Timeout> m_timeouts;
+      struct TimedWait
+      {
+         UInt64 seq;          // 0 when the thread is not in a timed wait
+         SimFutex *futex;     // Futex the thread is waiting on, NULL for sleeping threads
+      };
+      std::vector<TimedWait> m_timed_waits;
+      UInt64 m_timeout_seq;
+      UInt64 m_num_timed_waits;
+
+      bool isTimeoutValid(const Timeout &entry) const
+      { return m_timed_waits[entry.thread_id].seq == entry.seq; }
 
       // Handling Futexes
       typedef std::unordered_map<IntPtr, SimFutex> FutexMap;
       FutexMap m_futexes;
+      // Protects m_futexes and the waiter lists. Futex calls that do not need to stall or wake up a thread
+      // (FUTEX_WAIT on a changed value, FUTEX_WAKE without waiters) only take this lock; all others take
+      // the thread manager lock first. Lock order: thread manager lock, then m_futex_lock.
+      Lock m_futex_lock;
 
       friend class ThreadManager;
 };
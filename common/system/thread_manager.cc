@@ -25,9 +25,12 @@ static_assert(ThreadManager::STALL_TYPES_MAX == sizeof(ThreadManager::stall_type
               "Not enough values in ThreadManager::stall_type_names");
 
 ThreadManager::ThreadManager()
-   : m_thread_tls(TLS::create())
+   : m_thread_lock_stats(new ContentionLock())
+   , m_thread_lock(m_thread_lock_stats)
+   , m_thread_tls(TLS::create())
    , m_scheduler(Scheduler::create(this))
 {
+   m_thread_lock_stats->registerStats("thread_manager");
 }
 
 ThreadManager::~ThreadManager()
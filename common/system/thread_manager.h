@@ -5,6 +5,7 @@
 #include "semaphore.h"
 #include "core.h"
 #include "lock.h"
+#include "contention_lock.h"
 #include "subsecond_time.h"
 
 #include <vector>
@@ -91,6 +92,9 @@ private:
       ThreadState() : status(Core::IDLE), waiter(INVALID_THREAD_ID) {}
    };
 
+   // Global simulator lock. Hot paths (SyncServer, futexes, MagicServer frequency queries) avoid it where they can,
+   // the ContentionLock keeps track of how often the remaining users still collide.
+   ContentionLock *m_thread_lock_stats;
    Lock m_thread_lock;
 
    std::vector<ThreadState> m_thread_state;
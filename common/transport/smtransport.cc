@@ -1,8 +1,10 @@
 #include <string.h>
+#include <sched.h>
 
 #include "smtransport.h"
 #include "config.h"
 #include "log.h"
+#include "packet_buffer_pool.h"
 
 // -- SmTransport -- //
 
@@ -68,14 +70,25 @@ void SmTransport::clearNodeForId(core_id_t core_id)
 
 SmTransport::SmNode::SmNode(core_id_t core_id, SmTransport *smt)
    : Node(core_id)
+   , m_slots(new Slot[QUEUE_SIZE])
+   , m_tail(0)
+   , m_head(0)
+   , m_overflow_count(0)
+   , m_waiting(false)
    , m_smt(smt)
 {
+   for (UInt32 i = 0; i < QUEUE_SIZE; i++)
+   {
+      m_slots[i].seq = i;
+      m_slots[i].data = NULL;
+   }
 }
 
 SmTransport::SmNode::~SmNode()
 {
-   LOG_ASSERT_WARNING(m_queue.empty(), "Unread messages in queue for core: %d", getCoreId());
+   LOG_ASSERT_WARNING(empty(), "Unread messages in queue for core: %d", getCoreId());
    m_smt->clearNodeForId(getCoreId());
+   delete [] m_slots;
 }
 
 void SmTransport::SmNode::globalSend(SInt32 dest_proc, const void *buffer, UInt32 length)
@@ -93,49 +106,128 @@ void SmTransport::SmNode::send(SInt32 dest_id, const void* buffer, UInt32 length
 
 void SmTransport::SmNode::send(SmNode *dest_node, const void *buffer, UInt32 length)
 {
-   Byte *data = new Byte[length];
+   Byte *data = PacketBufferPool::alloc(length);
    memcpy(data, buffer, length);
 
    LOG_PRINT("sending msg -- size: %i, data: %p, dest: %p", length, data, dest_node);
 
-   dest_node->m_lock.acquire();
-   dest_node->m_queue.push(data);
-   dest_node->m_lock.release();
-   dest_node->m_cond.broadcast();
+   dest_node->push(data);
+}
+
+bool SmTransport::SmNode::tryPush(Byte *data)
+{
+   UInt64 pos = m_tail;
+   while (true)
+   {
+      Slot &slot = m_slots[pos & (QUEUE_SIZE - 1)];
+      UInt64 seq = slot.seq;
+      if (seq == pos)
+      {
+         // Slot is free, try to claim it
+         UInt64 prev = __sync_val_compare_and_swap(&m_tail, pos, pos + 1);
+         if (prev == pos)
+         {
+            slot.data = data;
+            __sync_synchronize();
+            slot.seq = pos + 1;
+            return true;
+         }
+         pos = prev;
+      }
+      else if (seq < pos)
+      {
+         // Slot still holds a packet from the previous round: ring is full
+         return false;
+      }
+      else
+      {
+         // Another producer claimed this slot
+         pos = m_tail;
+      }
+   }
+}
+
+void SmTransport::SmNode::push(Byte *data)
+{
+   if (m_overflow_count || !tryPush(data))
+   {
+      ScopedLock sl(m_lock);
+      m_overflow.push(data);
+      m_overflow_count = m_overflow.size();
+   }
+
+   // Pairs with the barrier in recv(): either we see the consumer is waiting, or it sees our packet
+   __sync_synchronize();
+   if (m_waiting)
+   {
+      // Taking the lock makes sure the consumer is inside m_cond.wait() before we signal
+      ScopedLock sl(m_lock);
+      m_cond.broadcast();
+   }
+}
+
+bool SmTransport::SmNode::tryPop(Byte *&data)
+{
+   Slot &slot = m_slots[m_head & (QUEUE_SIZE - 1)];
+   // Wait for producers that claimed a slot but did not publish it yet,
+   // if we'd skip ahead to the overflow queue their packets could be reordered
+   while (slot.seq != m_head + 1)
+   {
+      if (m_head == m_tail)
+         return false;
+      sched_yield();
+   }
+   __sync_synchronize();
+   data = slot.data;
+   slot.seq = m_head + QUEUE_SIZE;
+   ++m_head;
+   return true;
+}
+
+bool SmTransport::SmNode::empty()
+{
+   return m_head == m_tail && m_overflow_count == 0;
 }
 
 Byte* SmTransport::SmNode::recv()
 {
    LOG_PRINT("attempting recv -- this: %p", this);
 
-   m_lock.acquire();
-
    while (true)
    {
-      if (!m_queue.empty())
+      Byte *data;
+      if (tryPop(data))
       {
-         Byte *data = m_queue.front();
-         m_queue.pop();
-         m_lock.release();
-
          LOG_PRINT("msg recv'd -- data: %p, this: %p", data, this);
-
          return data;
       }
-      else
+
+      if (m_overflow_count)
       {
-         m_cond.wait(m_lock);
+         ScopedLock sl(m_lock);
+         // Only drain the overflow queue when the ring is empty, everything in it was sent after the ring's contents
+         if (m_head == m_tail && !m_overflow.empty())
+         {
+            data = m_overflow.front();
+            m_overflow.pop();
+            m_overflow_count = m_overflow.size();
+
+            LOG_PRINT("msg recv'd -- data: %p, this: %p", data, this);
+            return data;
+         }
+         continue;
       }
+
+      ScopedLock sl(m_lock);
+      m_waiting = true;
+      __sync_synchronize();
+      if (empty())
+         m_cond.wait(m_lock);
+      m_waiting = false;
    }
 }
 
 bool SmTransport::SmNode::query()
 {
-   bool result = false;
-
-   m_lock.acquire();
-   result = !m_queue.empty();
-   m_lock.release();
-
-   return result;
+   return !empty();
 }
@@ -24,10 +24,34 @@ public:
       bool query();
 
    private:
+      // Bounded multi-producer, single-consumer ring (only the owner of this node calls recv() and query()).
+      // Each slot carries a sequence number: a producer claims a slot by advancing m_tail,
+      // then publishes it by setting the slot's sequence number to position + 1.
+      static const UInt32 QUEUE_SIZE = 1024;  // Must be a power of two
+      struct Slot
+      {
+         volatile UInt64 seq;
+         Byte *data;
+      };
+
       void send(SmNode *dest, const void *buffer, UInt32 length);
+      void push(Byte *data);
+      bool tryPush(Byte *data);
+      bool tryPop(Byte *&data);
+      bool empty();
+
+      Slot *m_slots;
+      char m_padding0[64];
+      volatile UInt64 m_tail;    // Next slot to claim by producers
+      char m_padding1[64];
+      UInt64 m_head;             // Next slot to read by the consumer
 
-      std::queue<Byte*> m_queue;
-      Lock m_lock;
+      // Packets that did not fit in the ring. Once the overflow queue is non-empty, producers keep adding
+      // to it until the consumer has drained it, so packets from the same sender are never reordered.
+      std::queue<Byte*> m_overflow;
+      volatile UInt32 m_overflow_count;
+      volatile bool m_waiting;   // The consumer is (about to go) asleep on m_cond
+      Lock m_lock;               // Protects m_overflow, and sleeping/waking up the consumer
       ConditionVariable m_cond;
       SmTransport *m_smt;
    };
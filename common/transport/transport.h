@@ -17,6 +17,7 @@ public:
 
       virtual void globalSend(SInt32 dest_proc, const void *buffer, UInt32 length) = 0;
       virtual void send(core_id_t dest, const void *buffer, UInt32 length) = 0;
+      // Returns a copy of the sent message, to be released with PacketBufferPool::release()
       virtual Byte* recv() = 0;
       virtual bool query() = 0;
 
@@ -25,7 +25,7 @@ class LCTrace:
       'instrs': [ self.sd.getter('core', core, 'instructions') for core in range(sim.config.ncores) ],
       'misses': [ self.sd.getter('light_cache', core, 'misses') for core in range(sim.config.ncores) ],
     }
-    sim.util.Every(interval_ns * sim.util.Time.NS, self.periodic, statsdelta = self.sd, roi_only = True)
+    sim.util.Every(interval_ns * sim.util.Time.NS, self.periodic, statsdelta = self.sd, roi_only = True, pipelined = True)
 
   def periodic(self, time, time_delta):
     if self.isTerminal:
@@ -17,7 +17,7 @@ class PeriodicStats:
     self.interval = long(interval * sim.util.Time.NS)
     self.next_interval = float('inf')
     self.in_roi = False
-    sim.util.Every(self.interval, self.periodic, roi_only = True)
+    sim.util.Every(self.interval, self.periodic, roi_only = True, pipelined = True)
 
   def hook_roi_begin(self):
     self.in_roi = True
@@ -0,0 +1,74 @@
+// dvfs.so
+//
+// Native version of dvfs.py: change core frequencies according to a predefined list
+// Argument is a list of time,core,frequency values. Time is in nanoseconds, frequency in MHz
+// Example:
+//   -sdvfs.so:1000:1:3000:2500:1:2660
+// Change core 1 to 3 GHz after 1 us, change core 1 to 2.66 GHz after 2.5 us
+
+#include "sniper_plugin.h"
+#include "magic_server.h"
+#include "log.h"
+
+#include <algorithm>
+#include <vector>
+#include <stdlib.h>
+#include <string.h>
+
+namespace {
+
+struct DvfsEvent
+{
+   SubsecondTime time;
+   UInt64 core_id;
+   UInt64 freq_mhz;
+   bool operator<(const DvfsEvent &other) const { return time < other.time; }
+};
+
+std::vector<DvfsEvent> s_events;
+size_t s_next_event = 0;
+bool s_in_roi = false;
+
+SInt64 hookRoiBegin(UInt64, UInt64) { s_in_roi = true; return 0; }
+SInt64 hookRoiEnd(UInt64, UInt64) { s_in_roi = false; return 0; }
+
+SInt64 hookPeriodic(UInt64, UInt64 _time)
+{
+   if (!s_in_roi)
+      return 0;
+
+   SubsecondTime time(*(subsecond_time_t*)&_time);
+   while(s_next_event < s_events.size() && time >= s_events[s_next_event].time)
+   {
+      // We're running in a hook so we already have the thread lock, call MagicServer directly
+      Sim()->getMagicServer()->setFrequency(s_events[s_next_event].core_id, s_events[s_next_event].freq_mhz);
+      ++s_next_event;
+   }
+   return 0;
+}
+
+}
+
+SNIPER_PLUGIN_INIT(args)
+{
+   char *_args = strdup(args), *saveptr = NULL;
+   for(char *tok = strtok_r(_args, ":", &saveptr); tok; tok = strtok_r(NULL, ":", &saveptr))
+   {
+      char *core = strtok_r(NULL, ":", &saveptr);
+      char *freq = core ? strtok_r(NULL, ":", &saveptr) : NULL;
+      LOG_ASSERT_ERROR(freq, "dvfs.so: arguments should be a list of time:core:frequency values");
+
+      DvfsEvent event;
+      event.time = SubsecondTime::NS(strtoull(tok, NULL, 10));
+      event.core_id = strtoull(core, NULL, 10);
+      event.freq_mhz = strtoull(freq, NULL, 10);
+      s_events.push_back(event);
+   }
+   free(_args);
+   std::stable_sort(s_events.begin(), s_events.end());
+
+   // Register as ORDER_ACTION: we change simulator state
+   Sim()->getHooksManager()->registerHook(HookType::HOOK_ROI_BEGIN, hookRoiBegin, 0);
+   Sim()->getHooksManager()->registerHook(HookType::HOOK_ROI_END, hookRoiEnd, 0);
+   Sim()->getHooksManager()->registerHook(HookType::HOOK_PERIODIC, hookPeriodic, 0, HooksManager::ORDER_ACTION);
+}
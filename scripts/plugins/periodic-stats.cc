@@ -0,0 +1,93 @@
+// periodic-stats.so
+//
+// Native version of periodic-stats.py: periodically write out all statistics
+// 1st argument is the interval size in nanoseconds (default is 1e9 = 1 second of simulated time)
+// 2nd argument, if present will limit the number of snapshots and dynamically remove intermediate data
+
+#include "sniper_plugin.h"
+#include "clock_skew_minimization_object.h"
+#include "itostr.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+
+namespace {
+
+SubsecondTime s_interval = SubsecondTime::NS(1000000000);
+SubsecondTime s_next_interval = SubsecondTime::MaxTime();
+UInt64 s_max_snapshots = 0;
+UInt64 s_num_snapshots = 0;
+// Work decided on at the barrier, done by the pipelined observer
+std::vector<String> s_pending_deletes;
+String s_pending_write;
+
+SInt64 hookRoiBegin(UInt64, UInt64)
+{
+   s_next_interval = Sim()->getClockSkewMinimizationServer()->getGlobalTime() + s_interval;
+   Sim()->getStatsManager()->recordStats("periodic-0");
+   return 0;
+}
+
+SInt64 hookRoiEnd(UInt64, UInt64)
+{
+   s_next_interval = SubsecondTime::MaxTime();
+   return 0;
+}
+
+SInt64 hookPeriodic(UInt64, UInt64 _time)
+{
+   SubsecondTime time(*(subsecond_time_t*)&_time);
+
+   if (time >= s_next_interval)
+   {
+      if (s_max_snapshots && s_num_snapshots > s_max_snapshots)
+      {
+         // Too many snapshots: drop every other one and double the interval
+         s_num_snapshots /= 2;
+         for(SubsecondTime t = s_interval; t < time; t += s_interval * 2)
+            s_pending_deletes.push_back(String("periodic-") + itostr(t.getFS()));
+         s_interval = s_interval * 2;
+      }
+
+      ++s_num_snapshots;
+      s_pending_write = String("periodic-") + itostr((s_interval * s_num_snapshots).getFS());
+      s_next_interval += s_interval;
+      Sim()->getStatsManager()->requestFullSnapshot();
+   }
+   return 0;
+}
+
+SInt64 hookPeriodicPipelined(UInt64, UInt64)
+{
+   for(std::vector<String>::iterator it = s_pending_deletes.begin(); it != s_pending_deletes.end(); ++it)
+      Sim()->getStatsManager()->deleteStats(*it);
+   s_pending_deletes.clear();
+
+   if (!s_pending_write.empty())
+   {
+      Sim()->getStatsManager()->recordStats(s_pending_write);
+      s_pending_write.clear();
+   }
+   return 0;
+}
+
+}
+
+SNIPER_PLUGIN_INIT(args)
+{
+   char *_args = strdup(args), *saveptr = NULL;
+   char *interval = strtok_r(_args, ":", &saveptr);
+   char *max_snapshots = interval ? strtok_r(NULL, ":", &saveptr) : NULL;
+   if (interval && strtoull(interval, NULL, 10))
+      s_interval = SubsecondTime::NS(strtoull(interval, NULL, 10));
+   if (max_snapshots)
+      s_max_snapshots = strtoull(max_snapshots, NULL, 10);
+   free(_args);
+
+   Sim()->getHooksManager()->registerHook(HookType::HOOK_ROI_BEGIN, hookRoiBegin, 0);
+   Sim()->getHooksManager()->registerHook(HookType::HOOK_ROI_END, hookRoiEnd, 0);
+   Sim()->getHooksManager()->registerHook(HookType::HOOK_PERIODIC, hookPeriodic, 0);
+   // Writing the statistics database is the expensive part, it can overlap with the next quantum (hooks/periodic_pipelined)
+   Sim()->getHooksManager()->registerHook(HookType::HOOK_PERIODIC, hookPeriodicPipelined, 0, HooksManager::ORDER_NOTIFY_PIPELINED);
+}
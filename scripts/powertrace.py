@@ -8,7 +8,7 @@ class PowerTrace:
   def setup(self, args):
     args = dict(enumerate((args or '').split(':')))
     interval_ns = long(args.get(0, '') or 1000000)
-    sim.util.Every(interval_ns * sim.util.Time.NS, self.periodic, roi_only = True)
+    sim.util.Every(interval_ns * sim.util.Time.NS, self.periodic, roi_only = True, pipelined = True)
     self.t_last = 0
 
   def periodic(self, time, time_delta):
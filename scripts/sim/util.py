@@ -19,14 +19,19 @@ Register an object as being a hooks listener.
   Will register hooks callback functions to the object's member functions with matching (lowercase) names
   I.e. obj.hook_roi_begin will be called at HOOK_ROI_BEGIN, etc.
   Additionally, obj.setup(arg) will be called with <arg> being the script's arguments
+  Read-only observers can pass periodic_order = sim.hooks.ORDER_NOTIFY_PIPELINED to have hook_periodic
+  run on a service thread, overlapping with the next quantum, when hooks/periodic_pipelined is enabled
 """
 
-def register(obj):
+def register(obj, periodic_order = None):
 
   for name, hook in sim.hooks.hooks.items():
     func = getattr(obj, name.lower(), None)
     if func and callable(func):
-      sim.hooks.register(hook, func)
+      if hook == sim.hooks.HOOK_PERIODIC and periodic_order is not None:
+        sim.hooks.register(hook, func, periodic_order)
+      else:
+        sim.hooks.register(hook, func)
 
   if hasattr(obj, 'setup') and callable(obj.setup):
     obj.setup(sys.argv[1])
@@ -131,7 +136,7 @@ class StatsDelta:
 
 
 class Every:
-  def __init__(self, interval, callback, statsdelta = None, roi_only = True):
+  def __init__(self, interval, callback, statsdelta = None, roi_only = True, pipelined = False):
     min_interval = long(sim.config.get('clock_skew_minimization/barrier/quantum')) * 1e6
     if interval < min_interval:
       print >> sys.stderr, 'sim.util.Every(): interval(%dns) < periodic callback(%dns), consider reducing clock_skew_minimization/barrier/quantum' % (interval/1e6, min_interval/1e6)
@@ -142,29 +147,53 @@ class Every:
     self.time_next = 0
     self.time_last = 0
     self.in_roi = False
+    self.pipelined = pipelined
+    self.pending = None
     register(self)
+    if pipelined:
+      # The callback runs on a service thread against a snapshot of the statistics (which it may also write),
+      # so it must not change simulator state. Deciding when it is due is cheap and stays at the barrier.
+      sim.hooks.register(sim.hooks.HOOK_PERIODIC, self.hook_periodic_pipelined, sim.hooks.ORDER_NOTIFY_PIPELINED)
 
   def hook_roi_begin(self):
     self.in_roi = True
-    self.hook_periodic(sim.stats.time())
+    self.tick(sim.stats.time(), False)
 
   def hook_roi_end(self):
-    self.hook_periodic(sim.stats.time())
+    self.tick(sim.stats.time(), False)
     self.in_roi = False
 
   def hook_periodic(self, time):
+    self.tick(time, self.pipelined)
+
+  def hook_periodic_pipelined(self, time):
+    if self.pending:
+      time, time_delta = self.pending
+      self.pending = None
+      self.call(time, time_delta)
+
+  def tick(self, time, pipelined):
     if (not self.roi_only or self.in_roi) and time >= self.time_next:
       time_delta = time - self.time_last
       self.time_next = time + self.interval
       self.time_last = time
 
-      if self.statsdelta:
-        doCall = self.statsdelta.update()
+      if pipelined:
+        sim.stats.request_full_snapshot()
+        self.pending = (time, time_delta)
       else:
-        doCall = True
+        # Outside of a barrier: a pipelined call that has not started yet would now be out of order, drop it
+        self.pending = None
+        self.call(time, time_delta)
+
+  def call(self, time, time_delta):
+    if self.statsdelta:
+      doCall = self.statsdelta.update()
+    else:
+      doCall = True
 
-      if doCall:
-        self.callback(time, time_delta)
+    if doCall:
+      self.callback(time, time_delta)
 
 
 class EveryIns: